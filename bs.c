@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "bs.h"
+#include "log.h"
+
+// Open the swap file, creating it or growing it with zero pages to hold page_count pages
+void bs_open(BackingStore *bs, const char *swapfile, long page_count, int page_size, int mode) {
+    bs->fd = open(swapfile, O_RDWR | O_CREAT, 0644);
+    if (bs->fd < 0) {
+        fatal("Cannot open the swap file %s", swapfile);
+    }
+
+    struct stat st;
+    if (fstat(bs->fd, &st) < 0) {
+        fatal("Cannot stat the swap file");
+    }
+    bs->size = (size_t)page_count * page_size;
+    if ((size_t)st.st_size < bs->size) {
+        // A new or short swap file is extended with zero pages
+        if (ftruncate(bs->fd, bs->size) < 0) {
+            fatal("Cannot grow the swap file to %zu bytes", bs->size);
+        }
+    }
+
+    bs->mode = mode;
+    bs->map = NULL;
+    bs->extra = NULL;
+    bs->extra_size = 0;
+    bs->page_size = page_size;
+    bs->page_ins = 0;
+    bs->page_outs = 0;
+    bs->reads = 0;
+
+    if (mode == BS_MMAP) {
+        void *map = mmap(NULL, bs->size, PROT_READ | PROT_WRITE, MAP_SHARED, bs->fd, 0);
+        if (map == MAP_FAILED) {
+            LOG_WARN("cannot map the swap file, falling back to positional I/O");
+            bs->mode = BS_PIO;
+        } else {
+            bs->map = map;
+        }
+    } else if (mode == BS_MEM && bs->size > 0) {
+        // Every simulator gets its own view, the file's pages are shared until one is written
+        void *map = mmap(NULL, bs->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, bs->fd, 0);
+        if (map == MAP_FAILED) {
+            fatal("Cannot map the swap file");
+        }
+        bs->map = map;
+    }
+}
+
+// 1 if count pages at offset lie in the mapping, slots past the mapped size use positional I/O or, in BS_MEM mode,
+// private memory
+static int bs_mapped(BackingStore *bs, size_t offset, int count) {
+    return bs->map != NULL && offset + (size_t)count * bs->page_size <= bs->size;
+}
+
+// Page past the mapping in BS_MEM mode, growing the memory that holds them if asked, NULL if it was never written
+static uint8_t *bs_extra_page(BackingStore *bs, size_t offset, int grow) {
+    size_t end = offset - bs->size + bs->page_size;
+    if (end > bs->extra_size) {
+        if (!grow) {
+            return NULL;
+        }
+        size_t size = (bs->extra_size > 0) ? bs->extra_size : (size_t)bs->page_size * 64;
+        while (size < end) {
+            size *= 2;
+        }
+        bs->extra = realloc(bs->extra, size);
+        if (bs->extra == NULL) {
+            fatal("Out of memory for the swap space");
+        }
+        memset(bs->extra + bs->extra_size, 0, size - bs->extra_size);
+        bs->extra_size = size;
+    }
+    return bs->extra + (offset - bs->size);
+}
+
+// Copy a page of a BS_MEM backing store into a frame, pages that were never written are 0s
+static void bs_mem_read(BackingStore *bs, size_t offset, void *frame) {
+    uint8_t *page = bs_mapped(bs, offset, 1) ? bs->map + offset : bs_extra_page(bs, offset, 0);
+    if (page != NULL) {
+        memcpy(frame, page, bs->page_size);
+    } else {
+        memset(frame, 0, bs->page_size);
+    }
+}
+
+// Copy the page in a swap slot into a frame
+void bs_page_in(BackingStore *bs, long slot, void *frame) {
+    size_t offset = (size_t)slot * bs->page_size;
+    if (bs_mapped(bs, offset, 1)) {
+        memcpy(frame, bs->map + offset, bs->page_size);
+    } else if (bs->mode == BS_MEM) {
+        bs_mem_read(bs, offset, frame);
+    } else if (pread(bs->fd, frame, bs->page_size, offset) != bs->page_size) {
+        fatal("Cannot read swap slot %ld", slot);
+    }
+    bs->page_ins++;
+    bs->reads++;
+}
+
+// Copy the pages in count consecutive swap slots starting at slot into the given frames with a single read
+void bs_page_in_batch(BackingStore *bs, long slot, int count, void **frames) {
+    size_t offset = (size_t)slot * bs->page_size;
+    if (bs_mapped(bs, offset, count)) {
+        for (int i = 0; i < count; i++) {
+            memcpy(frames[i], bs->map + offset + (size_t)i * bs->page_size, bs->page_size);
+        }
+    } else if (bs->mode == BS_MEM) {
+        for (int i = 0; i < count; i++) {
+            bs_mem_read(bs, offset + (size_t)i * bs->page_size, frames[i]);
+        }
+    } else {
+        // Scatter the pages straight into their frames
+        struct iovec iov[count];
+        for (int i = 0; i < count; i++) {
+            iov[i].iov_base = frames[i];
+            iov[i].iov_len = bs->page_size;
+        }
+        if (preadv(bs->fd, iov, count, offset) != (ssize_t)count * bs->page_size) {
+            fatal("Cannot read swap slots %ld to %ld", slot, slot + count - 1);
+        }
+    }
+    bs->page_ins += count;
+    bs->reads++;
+}
+
+// Copy a frame to a swap slot of the backing store
+void bs_page_out(BackingStore *bs, long slot, const void *frame) {
+    size_t offset = (size_t)slot * bs->page_size;
+    if (bs_mapped(bs, offset, 1)) {
+        memcpy(bs->map + offset, frame, bs->page_size);
+    } else if (bs->mode == BS_MEM) {
+        memcpy(bs_extra_page(bs, offset, 1), frame, bs->page_size);
+    } else if (pwrite(bs->fd, frame, bs->page_size, offset) != bs->page_size) {
+        fatal("Cannot write swap slot %ld", slot);
+    }
+    bs->page_outs++;
+}
+
+// Write everything back and close the swap file
+void bs_close(BackingStore *bs) {
+    if (bs->map != NULL) {
+        munmap(bs->map, bs->size);  // Dirty pages of a shared mapping reach the file on their own
+        bs->map = NULL;
+    }
+    free(bs->extra);
+    bs->extra = NULL;
+    close(bs->fd);
+}
+
+// Parse the name of an I/O mode, returns -1 if unknown
+int bs_mode(const char *name) {
+    if (strcmp(name, "mmap") == 0) {
+        return BS_MMAP;
+    } else if (strcmp(name, "pio") == 0) {
+        return BS_PIO;
+    } else if (strcmp(name, "mem") == 0) {
+        return BS_MEM;
+    }
+    return -1;
+}
@@ -0,0 +1,45 @@
+#ifndef BS_H
+#define BS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Backing store I/O modes, selected with -i
+#define BS_MMAP 0 // the swap file is memory-mapped, page-in and page-out are a memcpy each (default)
+#define BS_PIO 1 // positional I/O with pread/pwrite, no shared file offset
+#define BS_MEM 2 // private copy-on-write mapping of the swap file, page-outs never reach the file
+
+// Structs
+
+// Backing store (swap space) holding each page in a swap slot at offset slot * page_size. Slots past the size it was
+// opened with are always accessed with positional I/O, the file grows as they are written.
+typedef struct {
+    int fd; // swap file descriptor
+    int mode; // BS_MMAP or BS_PIO
+    uint8_t *map; // mapping of the swap file in BS_MMAP and BS_MEM mode
+    size_t size; // size of the swap file in bytes
+    uint8_t *extra; // pages past the mapping in BS_MEM mode, grown as they are written
+    size_t extra_size; // bytes allocated for extra
+    int page_size; // size of each page in bytes
+    long page_ins; // pages read from the backing store
+    long page_outs; // pages written to the backing store
+    long reads; // read requests, a batched page-in is one request
+} BackingStore;
+
+
+// Function prototypes
+
+// Open the swap file, creating it or growing it with zero pages to hold page_count pages
+void bs_open(BackingStore *bs, const char *swapfile, long page_count, int page_size, int mode);
+// Copy the page in a swap slot into a frame
+void bs_page_in(BackingStore *bs, long slot, void *frame);
+// Copy the pages in count consecutive swap slots starting at slot into the given frames with a single read
+void bs_page_in_batch(BackingStore *bs, long slot, int count, void **frames);
+// Copy a frame to a swap slot of the backing store
+void bs_page_out(BackingStore *bs, long slot, const void *frame);
+// Write everything back and close the swap file
+void bs_close(BackingStore *bs);
+// Parse the name of an I/O mode, returns -1 if unknown
+int bs_mode(const char *name);
+
+#endif
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "log.h"
+#include "trace.h"
+
+// memsim-convert: turn a text address file into a compact .mtrace binary trace
+//
+//   memsim-convert -r addrfile -o mtracefile [-g page_size]
+
+// Global variables
+
+char addrfile[64]; // name of the text address file to convert
+char outfile[64]; // name of the binary trace to create
+int page_size = 64; // page size recorded in the trace header
+
+// Function prototypes
+
+// Read the command line arguments
+void read_args(int argc, char *argv[]);
+// Number of bits needed to hold the largest address of the trace
+int addr_width(uint64_t max_addr);
+
+
+// Main function
+int main(int argc, char *argv[]) {
+    // Read the command line arguments
+    read_args(argc, argv);
+
+    Trace trace;
+    trace_open(&trace, addrfile);
+    if (trace.binary) {
+        fatal("%s is already a binary trace", addrfile);
+    }
+
+    FILE *out_file = fopen(outfile, "wb");
+    if (out_file == NULL) {
+        fatal("Cannot create %s", outfile);
+    }
+
+    // Reserve the header, it is written once the reference count is known
+    uint8_t header_buf[MTRACE_HEADER_SIZE] = {0};
+    if (fwrite(header_buf, 1, sizeof(header_buf), out_file) != sizeof(header_buf)) {
+        fatal("Cannot write %s", outfile);
+    }
+
+    Ref *refs = malloc(TRACE_CHUNK * sizeof(Ref));
+    uint8_t *buf = malloc(TRACE_CHUNK * MTRACE_MAX_RECORD);
+    if (refs == NULL || buf == NULL) {
+        fatal("Cannot allocate the conversion buffers");
+    }
+    uint64_t ref_count = 0;
+    uint64_t out_size = MTRACE_HEADER_SIZE;
+    uint64_t max_addr = 0;
+    Ref prev = {0};  // the first record is encoded after address 0 of process 0
+    int n;
+
+    while ((n = trace_next(&trace, refs, TRACE_CHUNK)) > 0) {
+        size_t len = 0;
+        for (int i = 0; i < n; i++) {
+            len += mtrace_encode_ref(buf + len, &refs[i], &prev);
+            if (refs[i].addr > max_addr) {
+                max_addr = refs[i].addr;
+            }
+        }
+        if (fwrite(buf, 1, len, out_file) != len) {
+            fatal("Cannot write %s", outfile);
+        }
+        ref_count += n;
+        out_size += len;
+    }
+
+    // Fill in the header
+    MTraceHeader header;
+    header.addr_bits = addr_width(max_addr);
+    header.page_size = page_size;
+    header.ref_count = ref_count;
+    mtrace_encode_header(header_buf, &header);
+    if (fseek(out_file, 0, SEEK_SET) != 0) {
+        fatal("Cannot write %s", outfile);
+    }
+    if (fwrite(header_buf, 1, sizeof(header_buf), out_file) != sizeof(header_buf) || fclose(out_file) != 0) {
+        fatal("Cannot write %s", outfile);
+    }
+
+    printf("%llu references, %zu bytes -> %llu bytes\n", (unsigned long long)ref_count, trace.size,
+           (unsigned long long)out_size);
+
+    trace_close(&trace);
+    free(refs);
+    free(buf);
+    return 0;
+}
+
+
+// Function definitions
+
+// Read the command line arguments
+void read_args(int argc, char *argv[]) {
+    if (argc != 5 && argc != 7) {
+        printf("Usage: memsim-convert -r addrfile -o mtracefile [-g page_size]\n");
+        exit(1);
+    }
+    for (int i = 1; i < argc; i += 2) {
+        if (strcmp(argv[i], "-r") == 0) {
+            strcpy(addrfile, argv[i + 1]);
+        } else if (strcmp(argv[i], "-o") == 0) {
+            strcpy(outfile, argv[i + 1]);
+        } else if (strcmp(argv[i], "-g") == 0) {
+            page_size = atoi(argv[i + 1]);
+        } else {
+            fatal("Wrong argument");
+        }
+    }
+    if (addrfile[0] == '\0' || outfile[0] == '\0') {
+        fatal("Both -r and -o are required");
+    }
+    if (page_size <= 0 || (page_size & (page_size - 1)) != 0) {
+        fatal("Page size must be a power of two");
+    }
+}
+
+// Number of bits needed to hold the largest address of the trace
+int addr_width(uint64_t max_addr) {
+    int bits = 16;  // never narrower than the default 64 KB address space
+    while (bits < 64 && (max_addr >> bits) != 0) {
+        bits++;
+    }
+    return bits;
+}
@@ -0,0 +1,140 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Structs
+
+// Frame table entry: the page that owns a physical frame and its replacement state. The R, M and V bits of the
+// frames are bitmaps in the frame table.
+typedef struct {
+    long vpn; // virtual page number of the owning page
+    long slot; // swap slot of the owning page, -1 if it has none yet
+    unsigned short proc; // process that owns the page, an index in the process table
+    unsigned char ra; // readahead stream + 1 while the page is prefetched and not referenced yet, 0 otherwise
+    long load_time; // number of references done when the page was loaded
+    long next_use; // reference that uses the page next, LONG_MAX if none or unknown (only OPT looks at it)
+    int prev; // policy links, -1 at either end of a list
+    int next;
+} FrameInfo;
+
+// Inverted frame table, indexed by frame number
+typedef struct {
+    FrameInfo *entries; // one entry per frame
+    int size; // number of frames
+    int used; // frames handed out so far, frames [used, size) are still empty
+    int words; // 64 bit words of each bitmap
+    uint64_t *r; // referenced bit of each frame, bit f % 64 of word f / 64
+    uint64_t *m; // modified bit of each frame
+    uint64_t *v; // valid bit of each frame, set once it holds a page
+} FrameTable;
+
+// Doubly linked list of frames threaded through the policy links
+typedef struct {
+    int head; // first frame, -1 if empty
+    int tail; // last frame, -1 if empty
+} FrameList;
+
+
+// Test a bit of a frame bitmap
+static inline int bitmap_test(const uint64_t *bits, int frame) {
+    return (bits[frame >> 6] >> (frame & 63)) & 1;
+}
+
+// Set a bit of a frame bitmap
+static inline void bitmap_set(uint64_t *bits, int frame) {
+    bits[frame >> 6] |= 1ull << (frame & 63);
+}
+
+// Clear a bit of a frame bitmap
+static inline void bitmap_clear(uint64_t *bits, int frame) {
+    bits[frame >> 6] &= ~(1ull << (frame & 63));
+}
+
+// R bit of a frame
+static inline int frame_r(const FrameTable *ft, int frame) {
+    return bitmap_test(ft->r, frame);
+}
+
+// Set the R bit of a frame
+static inline void frame_set_r(FrameTable *ft, int frame) {
+    bitmap_set(ft->r, frame);
+}
+
+// Clear the R bit of a frame
+static inline void frame_clear_r(FrameTable *ft, int frame) {
+    bitmap_clear(ft->r, frame);
+}
+
+// Clear the R bits of all frames, a word at a time
+static inline void frame_clear_all_r(FrameTable *ft) {
+    memset(ft->r, 0, ft->words * sizeof(uint64_t));
+}
+
+// M bit of a frame
+static inline int frame_m(const FrameTable *ft, int frame) {
+    return bitmap_test(ft->m, frame);
+}
+
+// Set the M bit of a frame
+static inline void frame_set_m(FrameTable *ft, int frame) {
+    bitmap_set(ft->m, frame);
+}
+
+// Clear the M bit of a frame
+static inline void frame_clear_m(FrameTable *ft, int frame) {
+    bitmap_clear(ft->m, frame);
+}
+
+// First frame at or after start whose bit is set in bits, wrapping around once to the frames before start, -1 if
+// there is none. bits has ft->words words.
+static inline int bitmap_next(const FrameTable *ft, const uint64_t *bits, int start) {
+    int w = start >> 6;
+    uint64_t word = bits[w] & (~0ull << (start & 63));
+    for (int i = 0; i <= ft->words; i++) {
+        if (word != 0) {
+            return (w << 6) + __builtin_ctzll(word);
+        }
+        w = (w + 1 < ft->words) ? w + 1 : 0;
+        word = bits[w];
+    }
+    return -1;
+}
+
+// Append a frame to the end of a list
+static inline void frame_list_push_back(FrameTable *ft, FrameList *list, int frame) {
+    FrameInfo *fi = &ft->entries[frame];
+    fi->prev = list->tail;
+    fi->next = -1;
+    if (list->tail >= 0) {
+        ft->entries[list->tail].next = frame;
+    } else {
+        list->head = frame;
+    }
+    list->tail = frame;
+}
+
+// Remove a frame from a list
+static inline void frame_list_unlink(FrameTable *ft, FrameList *list, int frame) {
+    FrameInfo *fi = &ft->entries[frame];
+    if (fi->prev >= 0) {
+        ft->entries[fi->prev].next = fi->next;
+    } else {
+        list->head = fi->next;
+    }
+    if (fi->next >= 0) {
+        ft->entries[fi->next].prev = fi->prev;
+    } else {
+        list->tail = fi->prev;
+    }
+}
+
+// Remove and return the first frame of a non-empty list
+static inline int frame_list_pop_front(FrameTable *ft, FrameList *list) {
+    int frame = list->head;
+    frame_list_unlink(ft, list, frame);
+    return frame;
+}
+
+#endif
@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "log.h"
+#include "trace.h"
+
+// memsim-gen: write a synthetic .mtrace binary trace of a standard access pattern
+//
+//   memsim-gen -k kind -o mtracefile [-n refs] [-P pages] [-g page_size] [-w write_pct] [-z skew] [-c phases]
+//              [-s seed]
+//
+// Every pattern touches the pages [0, pages) of process 0, so the footprint is pages * page_size bytes:
+//   scan     walks the footprint one 8 byte word at a time and starts over at the end
+//   loop     references the pages in a cycle, one word of each page
+//   uniform  references a page chosen uniformly at random
+//   zipf     references pages with a Zipfian popularity of the given skew, the hottest pages are spread out
+//   phases   splits the trace into phases, each running scan, loop, uniform or zipf in turn over half of the
+//            footprint at a random place
+
+// Access patterns
+#define PATTERN_SCAN 0
+#define PATTERN_LOOP 1
+#define PATTERN_UNIFORM 2
+#define PATTERN_ZIPF 3
+
+// Structs
+
+// Pattern state of a phase
+typedef struct {
+    int kind; // pattern of the phase, one of the PATTERN_ values
+    int base; // first page of the phase's range
+    int pages; // pages in the range
+    long pos; // next word of a scan or next page of a loop
+} Pattern;
+
+// Global variables
+
+char kind[16]; // access pattern
+char outfile[64]; // name of the binary trace to create
+long ref_count = 1000000; // memory references to generate
+int pages = 1024; // pages in the footprint
+int page_size = 64; // page size in bytes
+int write_pct = 30; // percentage of references that are writes
+double skew = 0.99; // Zipf exponent
+int phases = 4; // phases of the phases pattern
+uint64_t seed = 1; // seed of the random number generator
+
+// Function prototypes
+
+// Read the command line arguments
+void read_args(int argc, char *argv[]);
+// Next number of the seeded random sequence (splitmix64)
+uint64_t next_random(uint64_t *state);
+// Build the Zipf CDF of n ranks and a random placement of the ranks on n pages
+void zipf_init(int n, double **cdf, int **page, uint64_t *state);
+// Page of the next reference of a pattern
+int next_page(Pattern *pat, const double *cdf, const int *rank_page, uint64_t *state, int *offset);
+// Narrowest address width memsim supports that holds the largest address of the trace
+int addr_width(uint64_t max_addr);
+
+
+// Main function
+int main(int argc, char *argv[]) {
+    // Read the command line arguments
+    read_args(argc, argv);
+
+    FILE *out_file = fopen(outfile, "wb");
+    if (out_file == NULL) {
+        fatal("Cannot create %s", outfile);
+    }
+
+    uint64_t state = seed;
+    int phased = (strcmp(kind, "phases") == 0);
+    int range = phased ? (pages >= 2 ? pages / 2 : 1) : pages;  // pages each phase works on
+    double *cdf = NULL;
+    int *rank_page = NULL;
+    zipf_init(range, &cdf, &rank_page, &state);
+
+    Pattern pat = {0, 0, range, 0};
+    if (!phased) {
+        const char *names[] = {"scan", "loop", "uniform", "zipf"};
+        while (strcmp(kind, names[pat.kind]) != 0) {
+            pat.kind++;
+        }
+    }
+    long phase_len = phased ? (ref_count + phases - 1) / phases : ref_count;
+
+    // Reserve the header, it is written once the address width is known
+    uint8_t header_buf[MTRACE_HEADER_SIZE] = {0};
+    if (fwrite(header_buf, 1, sizeof(header_buf), out_file) != sizeof(header_buf)) {
+        fatal("Cannot write %s", outfile);
+    }
+
+    uint8_t *buf = malloc(TRACE_CHUNK * MTRACE_MAX_RECORD);
+    if (buf == NULL) {
+        fatal("Cannot allocate the output buffer");
+    }
+    uint64_t out_size = MTRACE_HEADER_SIZE;
+    uint64_t max_addr = 0;
+    Ref prev = {0};  // the first record is encoded after address 0 of process 0
+    size_t len = 0;
+
+    for (long i = 0; i < ref_count; i++) {
+        if (phased && i % phase_len == 0) {
+            // Each phase moves to another pattern and another part of the footprint
+            pat.kind = (int)((i / phase_len) % 4);
+            pat.base = (int)(next_random(&state) % (uint64_t)(pages - range + 1));
+            pat.pos = 0;
+        }
+        int offset;
+        int page = pat.base + next_page(&pat, cdf, rank_page, &state, &offset);
+
+        Ref ref;
+        ref.pid = 0;
+        ref.addr = (uint64_t)page * page_size + offset;
+        ref.type = (next_random(&state) % 100 < (uint64_t)write_pct) ? 'w' : 'r';
+        ref.value = (ref.type == 'w') ? (int)(next_random(&state) & 0xff) : 0;
+        if (ref.addr > max_addr) {
+            max_addr = ref.addr;
+        }
+        len += mtrace_encode_ref(buf + len, &ref, &prev);
+        if (len > (TRACE_CHUNK - 1) * MTRACE_MAX_RECORD) {
+            if (fwrite(buf, 1, len, out_file) != len) {
+                fatal("Cannot write %s", outfile);
+            }
+            out_size += len;
+            len = 0;
+        }
+    }
+    if (fwrite(buf, 1, len, out_file) != len) {
+        fatal("Cannot write %s", outfile);
+    }
+    out_size += len;
+
+    // Fill in the header
+    MTraceHeader header;
+    header.addr_bits = addr_width(max_addr);
+    header.page_size = page_size;
+    header.ref_count = ref_count;
+    mtrace_encode_header(header_buf, &header);
+    if (fseek(out_file, 0, SEEK_SET) != 0) {
+        fatal("Cannot write %s", outfile);
+    }
+    if (fwrite(header_buf, 1, sizeof(header_buf), out_file) != sizeof(header_buf) || fclose(out_file) != 0) {
+        fatal("Cannot write %s", outfile);
+    }
+
+    printf("%s: %ld references over %d pages of %d bytes, %d bit addresses, %llu bytes\n", kind, ref_count, pages,
+           page_size, header.addr_bits, (unsigned long long)out_size);
+
+    free(buf);
+    free(cdf);
+    free(rank_page);
+    return 0;
+}
+
+
+// Function definitions
+
+// Read the command line arguments
+void read_args(int argc, char *argv[]) {
+    if (argc < 5 || argc % 2 == 0) {
+        printf("Usage: memsim-gen -k kind -o mtracefile [-n refs] [-P pages] [-g page_size] [-w write_pct] "
+               "[-z skew] [-c phases] [-s seed]\n");
+        exit(1);
+    }
+    for (int i = 1; i < argc; i += 2) {
+        if (strcmp(argv[i], "-k") == 0) {
+            if (strlen(argv[i + 1]) >= sizeof(kind)) {
+                fatal("Unknown pattern %s", argv[i + 1]);
+            }
+            strcpy(kind, argv[i + 1]);
+        } else if (strcmp(argv[i], "-o") == 0) {
+            if (strlen(argv[i + 1]) >= sizeof(outfile)) {
+                fatal("Trace file name %s is too long", argv[i + 1]);
+            }
+            strcpy(outfile, argv[i + 1]);
+        } else if (strcmp(argv[i], "-n") == 0) {
+            ref_count = atol(argv[i + 1]);
+        } else if (strcmp(argv[i], "-P") == 0) {
+            pages = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-g") == 0) {
+            page_size = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-w") == 0) {
+            write_pct = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-z") == 0) {
+            skew = atof(argv[i + 1]);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            phases = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            seed = strtoull(argv[i + 1], NULL, 10);
+        } else {
+            fatal("Wrong argument");
+        }
+    }
+    if (strcmp(kind, "scan") != 0 && strcmp(kind, "loop") != 0 && strcmp(kind, "uniform") != 0 &&
+        strcmp(kind, "zipf") != 0 && strcmp(kind, "phases") != 0) {
+        fatal("Pattern must be scan, loop, uniform, zipf or phases");
+    }
+    if (outfile[0] == '\0') {
+        fatal("-o is required");
+    }
+    if (ref_count < 1) {
+        fatal("Wrong number of references");
+    }
+    if (pages < 1) {
+        fatal("Wrong number of pages");
+    }
+    if (page_size < 64 || page_size > (1 << 20) || (page_size & (page_size - 1)) != 0) {
+        fatal("Page size must be a power of two from 64 to 1048576 bytes");
+    }
+    if (write_pct < 0 || write_pct > 100) {
+        fatal("Write percentage must be between 0 and 100");
+    }
+    if (skew < 0) {
+        fatal("Zipf skew cannot be negative");
+    }
+    if (phases < 1) {
+        fatal("Wrong number of phases");
+    }
+}
+
+// Next number of the seeded random sequence (splitmix64)
+uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Build the Zipf CDF of n ranks and a random placement of the ranks on n pages
+void zipf_init(int n, double **cdf, int **page, uint64_t *state) {
+    double *c = malloc(n * sizeof(double));
+    int *p = malloc(n * sizeof(int));
+    if (c == NULL || p == NULL) {
+        fatal("Cannot allocate the Zipf distribution");
+    }
+    double sum = 0;
+    for (int r = 0; r < n; r++) {
+        sum += 1.0 / pow(r + 1, skew);
+        c[r] = sum;
+    }
+    for (int r = 0; r < n; r++) {
+        c[r] /= sum;
+        p[r] = r;
+    }
+
+    // Shuffle the pages (Fisher-Yates) so the hot ones do not share page table nodes by construction
+    for (int r = n - 1; r > 0; r--) {
+        int j = (int)(next_random(state) % (uint64_t)(r + 1));
+        int t = p[r];
+        p[r] = p[j];
+        p[j] = t;
+    }
+    *cdf = c;
+    *page = p;
+}
+
+// Page of the next reference of a pattern
+int next_page(Pattern *pat, const double *cdf, const int *rank_page, uint64_t *state, int *offset) {
+    int words = page_size / 8;
+    *offset = (int)(next_random(state) % (uint64_t)words) * 8;
+    switch (pat->kind) {
+        case PATTERN_SCAN: {
+            long word = pat->pos++ % ((long)pat->pages * words);
+            *offset = (int)(word % words) * 8;
+            return (int)(word / words);
+        }
+        case PATTERN_LOOP:
+            return (int)(pat->pos++ % pat->pages);
+        case PATTERN_UNIFORM:
+            return (int)(next_random(state) % (uint64_t)pat->pages);
+        default: {
+            // Binary search the CDF for the rank of a uniform number in [0, 1)
+            double u = (next_random(state) >> 11) * 0x1.0p-53;
+            int lo = 0;
+            int hi = pat->pages - 1;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (cdf[mid] > u) {
+                    hi = mid;
+                } else {
+                    lo = mid + 1;
+                }
+            }
+            return rank_page[lo];
+        }
+    }
+}
+
+// Narrowest address width memsim supports that holds the largest address of the trace
+int addr_width(uint64_t max_addr) {
+    int bits = 16;  // never narrower than the default 64 KB address space
+    while (bits < 64 && (max_addr >> bits) != 0) {
+        bits++;
+    }
+    int width = trace_va_bits(bits);
+    if (width == 0) {
+        fatal("The footprint needs %d bit addresses, memsim supports at most 48", bits);
+    }
+    return width;
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ghost.h"
+#include "log.h"
+
+// Hash bucket of a page key
+static int ghost_bucket(const Ghosts *g, uint64_t key) {
+    return (int)((key * 0x9E3779B97F4A7C15ull) >> 32) & g->mask;
+}
+
+// Allocate a directory of size ghosts
+void ghosts_init(Ghosts *g, int size) {
+    g->size = size;
+    g->mask = 1;
+    while (g->mask < size) {
+        g->mask *= 2;
+    }
+    g->keys = malloc(size * sizeof(uint64_t));
+    g->owner = malloc(size * sizeof(GhostList *));
+    g->prev = malloc(size * sizeof(int));
+    g->next = malloc(size * sizeof(int));
+    g->chain = malloc(size * sizeof(int));
+    g->bucket = malloc(g->mask * sizeof(int));
+    if (g->keys == NULL || g->owner == NULL || g->prev == NULL || g->next == NULL || g->chain == NULL ||
+        g->bucket == NULL) {
+        fatal("Cannot allocate the ghost directory");
+    }
+    for (int i = 0; i < g->mask; i++) {
+        g->bucket[i] = -1;
+    }
+    g->mask--;
+
+    // Every entry starts in the free list
+    for (int i = 0; i < size; i++) {
+        g->owner[i] = NULL;
+        g->chain[i] = (i + 1 < size) ? i + 1 : -1;
+    }
+    g->free = (size > 0) ? 0 : -1;
+}
+
+// Entry of a page, -1 if it is not a ghost
+int ghost_find(const Ghosts *g, uint64_t key) {
+    int i = g->bucket[ghost_bucket(g, key)];
+    while (i >= 0 && g->keys[i] != key) {
+        i = g->chain[i];
+    }
+    return i;
+}
+
+// Add a page as the newest ghost of a list, returns its entry
+int ghost_push(Ghosts *g, GhostList *list, uint64_t key) {
+    int i = g->free;
+    if (i < 0) {
+        fatal("Ghost directory of %d pages is full", g->size);
+    }
+    g->free = g->chain[i];
+
+    int b = ghost_bucket(g, key);
+    g->keys[i] = key;
+    g->chain[i] = g->bucket[b];
+    g->bucket[b] = i;
+
+    g->owner[i] = list;
+    g->prev[i] = list->tail;
+    g->next[i] = -1;
+    if (list->tail >= 0) {
+        g->next[list->tail] = i;
+    } else {
+        list->head = i;
+    }
+    list->tail = i;
+    list->count++;
+    return i;
+}
+
+// Forget a ghost
+void ghost_remove(Ghosts *g, int entry) {
+    GhostList *list = g->owner[entry];
+    if (g->prev[entry] >= 0) {
+        g->next[g->prev[entry]] = g->next[entry];
+    } else {
+        list->head = g->next[entry];
+    }
+    if (g->next[entry] >= 0) {
+        g->prev[g->next[entry]] = g->prev[entry];
+    } else {
+        list->tail = g->prev[entry];
+    }
+    list->count--;
+
+    // Unchain it from its bucket and return it to the free list
+    int *link = &g->bucket[ghost_bucket(g, g->keys[entry])];
+    while (*link != entry) {
+        link = &g->chain[*link];
+    }
+    *link = g->chain[entry];
+    g->owner[entry] = NULL;
+    g->chain[entry] = g->free;
+    g->free = entry;
+}
+
+// Forget the oldest ghost of a non-empty list
+void ghost_drop_oldest(Ghosts *g, GhostList *list) {
+    ghost_remove(g, list->head);
+}
+
+// Free the directory
+void ghosts_free(Ghosts *g) {
+    free(g->keys);
+    free(g->owner);
+    free(g->prev);
+    free(g->next);
+    free(g->chain);
+    free(g->bucket);
+}
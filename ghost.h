@@ -0,0 +1,45 @@
+#ifndef GHOST_H
+#define GHOST_H
+
+#include <stdint.h>
+
+// Structs
+
+// LRU list of ghosts, from the oldest (head) to the newest (tail)
+typedef struct {
+    int head; // first ghost, -1 if empty
+    int tail; // last ghost, -1 if empty
+    int count; // ghosts in the list
+} GhostList;
+
+// Directory of recently evicted pages (ghosts) for the adaptive policies. A fixed pool of entries, each on one
+// GhostList and found by its page key through a chained hash table, so every operation is O(1).
+typedef struct {
+    uint64_t *keys; // page key of each entry
+    GhostList **owner; // list holding each entry, NULL while it is free
+    int *prev; // list links, -1 at either end of a list
+    int *next;
+    int *chain; // next entry in the same hash bucket, or in the free list
+    int *bucket; // first entry of each hash bucket, -1 if empty
+    int mask; // buckets - 1
+    int free; // first free entry, -1 if none is left
+    int size; // entries in the pool
+} Ghosts;
+
+
+// Function prototypes
+
+// Allocate a directory of size ghosts
+void ghosts_init(Ghosts *g, int size);
+// Entry of a page, -1 if it is not a ghost
+int ghost_find(const Ghosts *g, uint64_t key);
+// Add a page as the newest ghost of a list, returns its entry
+int ghost_push(Ghosts *g, GhostList *list, uint64_t key);
+// Forget a ghost
+void ghost_remove(Ghosts *g, int entry);
+// Forget the oldest ghost of a non-empty list
+void ghost_drop_oldest(Ghosts *g, GhostList *list);
+// Free the directory
+void ghosts_free(Ghosts *g);
+
+#endif
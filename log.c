@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+#include "log.h"
+
+// Global variables
+
+int log_level = LOG_LEVEL_INFO; // runtime verbosity level
+
+static char *ring; // ring buffer for debug and trace messages, NULL if not in use
+static size_t ring_head; // total number of bytes ever written to the ring buffer
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER; // serializes the threads of a sweep
+
+// Append len bytes to the ring buffer, overwriting the oldest messages
+static void ring_append(const char *msg, size_t len) {
+    if (len > MEMSIM_LOG_RING) {
+        msg += len - MEMSIM_LOG_RING;
+        len = MEMSIM_LOG_RING;
+    }
+    size_t start = ring_head % MEMSIM_LOG_RING;
+    size_t first = MEMSIM_LOG_RING - start;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(ring + start, msg, first);
+    memcpy(ring, msg + first, len - first);
+    ring_head += len;
+}
+
+// Set the runtime verbosity level and allocate the ring buffer if debug messages are enabled
+void log_init(int level) {
+    log_level = level;
+    if (LOG_ENABLED(LOG_LEVEL_DEBUG) && ring == NULL) {
+        ring = malloc(MEMSIM_LOG_RING);
+        ring_head = 0;
+        atexit(log_dump);
+    }
+}
+
+// Write one message: warnings and info go to stdout, debug and trace messages to the ring buffer
+void log_write(int level, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    if (level < LOG_LEVEL_DEBUG || ring == NULL) {
+        flockfile(stdout);  // keep the lines of concurrent simulators whole
+        if (level == LOG_LEVEL_WARN) {
+            printf("Warning: ");
+        }
+        vprintf(fmt, args);
+        putchar('\n');
+        funlockfile(stdout);
+    } else {
+        char msg[512];
+        int len = vsnprintf(msg, sizeof(msg) - 1, fmt, args);
+        if (len > (int)sizeof(msg) - 2) {
+            len = sizeof(msg) - 2;
+        }
+        msg[len++] = '\n';
+        pthread_mutex_lock(&ring_lock);
+        ring_append(msg, len);
+        pthread_mutex_unlock(&ring_lock);
+    }
+    va_end(args);
+}
+
+// Dump the ring buffer to stderr
+void log_dump(void) {
+    if (ring == NULL || ring_head == 0) {
+        return;
+    }
+    fflush(stdout);
+    if (ring_head > MEMSIM_LOG_RING) {
+        // The buffer wrapped, skip the partly overwritten oldest message
+        size_t start = ring_head % MEMSIM_LOG_RING;
+        const char *eol = memchr(ring + start, '\n', MEMSIM_LOG_RING - start);
+        if (eol != NULL) {
+            fwrite(eol + 1, 1, ring + MEMSIM_LOG_RING - eol - 1, stderr);
+        }
+        fwrite(ring, 1, start, stderr);
+    } else {
+        fwrite(ring, 1, ring_head, stderr);
+    }
+    ring_head = 0;
+}
+
+// Print an error, dump the ring buffer and exit
+void fatal(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    printf("Error: ");
+    vprintf(fmt, args);
+    putchar('\n');
+    va_end(args);
+    log_dump();
+    exit(1);
+}
@@ -0,0 +1,51 @@
+#ifndef LOG_H
+#define LOG_H
+
+// Verbosity levels, selected at run time with -v
+#define LOG_LEVEL_ERROR 0 // errors only
+#define LOG_LEVEL_WARN 1 // warnings
+#define LOG_LEVEL_INFO 2 // configuration and summary (default)
+#define LOG_LEVEL_DEBUG 3 // one line per page fault and replacement
+#define LOG_LEVEL_TRACE 4 // one line per memory reference and policy step
+
+// Highest level compiled in. Release builds stop at LOG_LEVEL_INFO, so the
+// debug and trace calls in the simulation loop compile away entirely.
+#ifndef MEMSIM_LOG_MAX
+#ifdef MEMSIM_DEBUG
+#define MEMSIM_LOG_MAX LOG_LEVEL_TRACE
+#else
+#define MEMSIM_LOG_MAX LOG_LEVEL_INFO
+#endif
+#endif
+
+// Size of the ring buffer that holds debug and trace messages
+#ifndef MEMSIM_LOG_RING
+#define MEMSIM_LOG_RING (1 << 20)
+#endif
+
+// Global variables
+
+extern int log_level; // runtime verbosity level
+
+// True if messages of the given level are both compiled in and enabled
+#define LOG_ENABLED(level) ((level) <= MEMSIM_LOG_MAX && (level) <= log_level)
+
+#define LOG(level, ...) do { if (LOG_ENABLED(level)) log_write(level, __VA_ARGS__); } while (0)
+#define LOG_WARN(...) LOG(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...) LOG(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_TRACE(...) LOG(LOG_LEVEL_TRACE, __VA_ARGS__)
+
+
+// Function prototypes
+
+// Set the runtime verbosity level and allocate the ring buffer if debug messages are enabled
+void log_init(int level);
+// Write one message: warnings and info go to stdout, debug and trace messages to the ring buffer
+void log_write(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+// Dump the ring buffer to stderr
+void log_dump(void);
+// Print an error, dump the ring buffer and exit
+void fatal(const char *fmt, ...) __attribute__((format(printf, 1, 2), noreturn));
+
+#endif
@@ -1,91 +1,63 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
 #include <time.h>
-#include <unistd.h>
-#include <stdint.h>
+
+#include "log.h"
+#include "mrc.h"
+#include "sim.h"
+#include "sweep.h"
+#include "trace.h"
+
+// Largest number of values in a sweep list
+#define MAX_SWEEP 64
 
 // Global variables
 
-int level; // number of levels in the page table, 1 <= level <= 2
+SimConfig cfg = {.page_size = 64, .io_mode = BS_MMAP, .tlb_ways = 1, .tlb_policy = TLB_LRU}; // options, va_bits
+// stays 0 until -x or the trace sets it
+char bits_spec[64]; // index bits of each page table level (-b), split evenly if empty
 char addrfile[64]; // name of the file containing the memory references (virtual addresses)
-char swapfile[64]; // name of the file containing the backing store (swap space), size = virtual memory size (64 KB), 
-// 1024 pages, size of each page = 64 bytes. If it doesn't exist, create it and initialize it to all 0s.
-int fcount; // number of frames in the physical memory, 4 <= fcount <= 128
-int PAGE_SIZE = 64; // size of each page in bytes
-char algo[64]; // name of the page replacement algorithm: FIFO, LRU, CLOCK, ECLOCK
-int tick; // timer tick period in number of memory references done
+char swapfile[64]; // name of the file containing the backing store (swap space). For address spaces of up to 2^20
+// pages it holds every page of process 0 at vpn * page size (64 KB for the default 16 bit addresses, 1024 pages of
+// 64 bytes), larger address spaces and other processes give a page a slot the first time it is written out.
+// If it doesn't exist, create it.
 char outfile[64]; // name of the file containing the output of the simulation
-int lru_order[128]; // LRU order of the frames in the physical memory
-int fifo_order[128]; // FIFO order of the frames in the physical memory
-int clock_hand_order[128]; // CLOCK order of the frames in the physical memory
-int eclock_hand_order[128]; // ECLOCK order of the frames in the physical memory
-int next_empty_frame = 0;
-// Structs
-
-// Page table entry
-typedef struct { // 16 bits --> square root of fcount bits frame number, referenced bit, modified bit
-    uint16_t frame : 13; // Frame number, now 13 bits
-    uint16_t r : 1;      // Referenced bit
-    uint16_t m : 1;      // Modified bit
-    uint16_t v : 1;      // Valid bit
-} PTE;
-
-// Page table
-typedef struct {
-    PTE *entries; // array of page table entries
-    int size; // size of the page table
-} PT;
-
-// Frame
-typedef struct {
-    uint8_t data[64]; // Data stored in the frame
-} Frame;
-
-// Physical memory
-typedef struct {
-    Frame *frames; // array of frames
-    int size; // size of the physical memory
-} PM;
-
-// Page
-typedef struct {
-    uint8_t data[64]; // Data stored in the page
-} Page;
-
-// Virtual memory
-typedef struct {
-    Page *pages; // array of pages
-    int size; // size of the virtual memory
-} VM;
-
-// Memory reference
-typedef struct {
-    char type; // type of memory reference: r (read), w (write)
-    int addr; // virtual address
-    int value; // value to write (if type is w)
-} Ref;
+int out_mode = OUT_TEXT; // format of the output file: text, binary or summary only
+int sweep_threads = -1; // threads of a parameter sweep (0 for one per CPU), -1 for a single simulation
+char statsfile[64]; // JSON file of detailed statistics (-J), none if empty
+long stats_every; // references between two statistics snapshots, 0 for the final one only
+char benchfile[64]; // CSV file a sweep appends the throughput and swap I/O of each run to (-B), none if empty
+int mrc_mode = -1; // miss-ratio curve analysis to run instead of a simulation, -1 to simulate
+long mrc_budget = MRC_DEFAULT_BUDGET; // pages a sampled miss-ratio curve follows at once
+int levels[MAX_SWEEP]; // page table levels to simulate (-p)
+int level_count;
+int fcounts[MAX_SWEEP]; // frame counts to simulate (-f)
+int fcount_count;
+char algos[MAX_SWEEP][64]; // page replacement algorithms to simulate (-a)
+int algo_count;
 
 
 // Function prototypes
 
 // Read the command line arguments
 void read_args(int argc, char *argv[]);
-// Read the memory references (virtual addresses) from the address file
-void read_refs(char *addrfile, Ref *refs, int *ref_count);
-// Initialize the page table
-void init_pt(PT *pt, int levels);
-// Initialize the physical memory
-void init_pm(PM *pm);
-// Initialize the virtual memory
-void init_vm(VM *vm, int levels);
-// Initialize the backing store
-void init_bs(char *swapfile);
-// Write the physical memory to the backing store
-void write_pm_to_swap(PM *pm);
-// update the LRU order
-void update_lru_order(int vpn, int pm_size, int levels);
+// Fit the address width to the trace, then check the configuration and log it
+void check_config(const Trace *trace);
+// Parse a comma separated list of numbers and lo-hi[:step] ranges, returns the number of values
+int parse_int_list(const char *spec, int *values);
+// Parse a comma separated list of names, returns the number of names
+int parse_name_list(const char *spec, char names[][64]);
+// Split a name[:number] option at its last ':' if a number follows it, returns 1 if there was a number
+int split_option(const char *spec, char *name, size_t size, long *number);
+// Run one simulation and write a line per reference to the output file
+void run_single(Trace *trace);
+// Run every combination of levels, frame counts and algorithms and write the page fault ratio matrix
+void run_sweep(Trace *trace);
+// Append one line per sweep run with its fault ratio, swap I/O and throughput to the benchmark file
+void write_bench(const SweepRun *runs, int count, long ref_count);
+// Compute the LRU page faults of every memory size up to fcount in one pass and write them to the output file
+void run_mrc(Trace *trace);
 
 
 // Main function
@@ -93,702 +65,19 @@ int main(int argc, char *argv[]) {
     // Read the command line arguments
     read_args(argc, argv);
 
-    // Read the memory references (virtual addresses) from the address file
-    Ref *refs = malloc(1000000 * sizeof(Ref));  // Allocate memory for the array of memory references
-    int ref_count;  // Number of memory references
-    read_refs(addrfile, refs, &ref_count);
-
-    // Initialize the page table
-    PT pt;
-    init_pt(&pt, level);
-
-    // Initialize the physical memory
-    PM pm;
-    init_pm(&pm);
-
-    // Initialize the virtual memory
-    VM vm;
-    init_vm(&vm, level);
-
-    // Initialize the backing store
-    init_bs(swapfile);
-    
-    // Open the swap file in read/write mode
-    FILE *swap_file = fopen(swapfile, "rb+");  
-
-    // Open the output file in write mode
-    FILE *out_file = fopen(outfile, "w");
-
-    // Initialize the page fault counter
-    int pfault_count = 0;
-
-    // Initialize the timer
-    int timer = 0;
-
-    // Initialize the clock hand
-    int clock_hand = 0;
-
-    // Initialize the enhanced clock hand
-    int eclock_hand = 0;
-
-    // Initialize the LRU order
-    for (int i = 0; i < pm.size; i++) {
-        lru_order[i] = 0;
-    }
-
-    // print the LRU order
-    printf("lru_order before simulation:\n");
-    for (int i = 0; i < pm.size; i++) {
-        printf("lru_order[%d]: %d\n", i, lru_order[i]);
-    }
-
-    // create an array that holds 32 page tables and initialize them to null page tables 
-    PT pt_array[32];
-    for (int i = 0; i < 32; i++) {
-        pt_array[i].entries = NULL;
-        pt_array[i].size = 0;
-    }
-
-    // simulating the memory references
-    for (int i = 0; i < ref_count; i++) {
-
-        // clear the R bits in the page table entries every tick memory references
-        if (i != 0 && i % tick == 0) {
-            for (int j = 0; j < pt.size; j++) {
-                pt.entries[j].r = 0;
-            }
-        }
-
-        Ref ref = refs[i];  // Get the current memory reference
-
-        // write the memory reference to the output file
-        fprintf(out_file, "ADDR:0x%04x ", ref.addr);
-
-        // Translate the virtual address to a physical address
-        int vpn = ref.addr >> 6;  // virtual page number
-        int offset = ref.addr & 0x3f;  // offset
-        // If single-level paging is used, then PTE1 will be the index of the single-level page table entry used in translation.
-        int pte1 = (level == 1) ? vpn : (vpn >> 5);  // page table entry 1
-        // int pte1 = vpn >> 5;  // page table entry 1
-        int pte2 = (level == 1) ? 0 : (vpn & 0x1f);  // page table entry 2
-        int pfn = -1;  // physical frame number
-        int pa = -1;  // physical address
-
-        int pageFault = 0;  // page fault flag
-
-        // write the page table entries and the offset to the output file
-        fprintf(out_file, "PTE1:0x%01x ", pte1);
-        fprintf(out_file, "PTE2:0x%01x ", pte2);
-        fprintf(out_file, "offset:0x%01x ", offset);
-
-        printf("vpn: %d\n", vpn);
-        printf("offset: %d\n", offset);
-        printf("pte1: %d\n", pte1);
-        printf("pte2: %d\n", pte2);
-        printf("pt.entries[vpn].v: %d\n", pt.entries[vpn].v);
-
-        if (level == 1) {
-            // Single-level paging
-            if (pt.entries[vpn].v == 0) {
-                // Page fault
-                pageFault = 1;
-                pfault_count++;
-                // Load the page from the backing store
-                fseek(swap_file, vpn * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                Page page;  // Page to be loaded
-                fread(&page, sizeof(Page), 1, swap_file);  // Read the page from the swap fill
-                
-                if (next_empty_frame >= pm.size) {
-                    printf("Error: No empty frame\n");
-                    // No empty frame
-                    // Page replacement
-                    if (strcmp(algo, "FIFO") == 0) {
-                        printf("FIFO algorithm runs\n");
-                        // FIFO
-                        // Select the victim page
-                        int victim_page = fifo_order[0];
-                        printf("victim_page: %d\n", victim_page);
-
-                        // find the frame number associated with the victim page
-                        int victim_frame = pt.entries[victim_page].frame;
-                        printf("victim_frame: %d\n", victim_frame);
-
-                        // Write the victim page to the backing store if it is modified
-                        if (pt.entries[victim_page].m == 1) {
-                            fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                            fwrite(&pm.frames[victim_frame], sizeof(Frame), 1, swap_file);  // Write the page to the swap file
-                        }
-
-                        // Load the page from the backing store
-                        fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                        Page page;  // Page to be loaded
-                        fread(&page, sizeof(Page), 1, swap_file);  // Read the page from the swap file
-
-                        // Update the page table
-                        pt.entries[vpn].frame = victim_frame;
-                        pt.entries[vpn].r = 1;
-                        pt.entries[vpn].m = 0;
-                        pt.entries[vpn].v = 1;
-
-                        // update the physical memory
-                        for(int i = 1; i < PAGE_SIZE; i++) {
-                            pm.frames[victim_frame].data[i] = page.data[i];
-                        }
-
-                        // Update the FIFO order
-                        for (int i = 0; i < pm.size - 1; i++) {
-                            fifo_order[i] = fifo_order[i + 1];
-                        }
-
-                        fifo_order[pm.size - 1] = vpn;
-                        pfn = victim_frame;
-                        pa = pfn * PAGE_SIZE + offset;
-
-                    } else if (strcmp(algo, "LRU") == 0) {
-                        printf("LRU algorithm runs\n");
-                        // LRU
-                        // Select the victim page
-                        int victim_page = lru_order[pm.size - 1];
-                        printf("victim_page: %d\n", victim_page);
-
-                        // find the frame number associated with the victim page
-                        int victim_frame = pt.entries[victim_page].frame;
-                        printf("victim_frame: %d\n", victim_frame);
-
-                        // Write the victim page to the backing store if it is modified
-                        if (pt.entries[victim_page].m == 1) {
-                            fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                            fwrite(&pm.frames[victim_frame], sizeof(Frame), 1, swap_file);  // Write the page to the swap file
-                        }
-
-                        // Load the page from the backing store
-                        fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                        Page page;  // Page to be loaded
-                        fread(&page, sizeof(Page), 1, swap_file);  // Read the page from the swap file
-
-                        // Update the page table
-                        pt.entries[vpn].frame = victim_frame;
-                        pt.entries[vpn].r = 1;
-                        pt.entries[vpn].m = 0;
-                        pt.entries[vpn].v = 1;
-
-                        // update the physical memory
-                        for(int i = 1; i < PAGE_SIZE; i++) {
-                            pm.frames[victim_frame].data[i] = page.data[i];
-                        }
-
-                        // Update the LRU order
-                        update_lru_order(vpn, pm.size, level);
-
-                        pfn = victim_frame;
-                        pa = pfn * PAGE_SIZE + offset;
-                    } else if (strcmp(algo, "CLOCK") == 0) {
-                        printf("CLOCK algorithm runs\n");
-                        // CLOCK
-
-                        // Select the victim page
-                        int victim_page = -1;
-                        int found = 0;
-                        while (!found) {
-                            if (pt.entries[clock_hand_order[clock_hand]].r == 0) {
-                                victim_page = clock_hand_order[clock_hand];
-                                found = 1;
-                            } else {
-                                pt.entries[clock_hand_order[clock_hand]].r = 0;
-                                clock_hand = (clock_hand + 1) % pm.size;
-                            }
-                        }
-
-                        printf("victim_page: %d\n", victim_page);
-
-                        // find the frame number associated with the victim page
-                        int victim_frame = pt.entries[victim_page].frame;
-                        printf("victim_frame: %d\n", victim_frame);
-
-                        // Write the victim page to the backing store if it is modified
-                        if (pt.entries[victim_page].m == 1) {
-                            fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                            fwrite(&pm.frames[victim_frame], sizeof(Frame), 1, swap_file);  // Write the page to the swap file
-                        }
-
-                        // Load the page from the backing store
-                        fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                        Page page;  // Page to be loaded
-                        fread(&page, sizeof(Page), 1, swap_file);  // Read the page from the swap file
-
-                        // Update the page table
-                        pt.entries[vpn].frame = victim_frame;
-                        pt.entries[vpn].r = 1;
-                        pt.entries[vpn].m = 0;
-                        pt.entries[vpn].v = 1;
-
-                        // update the physical memory
-                        for(int i = 1; i < PAGE_SIZE; i++) {
-                            pm.frames[victim_frame].data[i] = page.data[i];
-                        }
-
-                        // Update the CLOCK order
-                        for (int i = 0; i < pm.size - 1; i++) {
-                            clock_hand_order[i] = clock_hand_order[i + 1];
-                        }
-
-                        clock_hand_order[pm.size - 1] = vpn;
-
-                        pfn = victim_frame;
-                        pa = pfn * PAGE_SIZE + offset;
-                    } else if (strcmp(algo, "ECLOCK") == 0) {
-                        printf("ECLOCK algorithm runs\n");
-                        // ECLOCK
-
-                        // Select the victim page
-                        int victim_page = -1;
-                        int found = 0;
-
-                        printf("eclock_hand1: %d\n", eclock_hand);
-
-                        // Step 1                        
-                        for (int i = 0; i <= pm.size -1; i++){
-                            printf("eclock_hand1: %d\n", eclock_hand);
-                            printf("i: %d\n", i);
-                            if (pt.entries[eclock_hand_order[eclock_hand]].r == 0 && pt.entries[eclock_hand_order[eclock_hand]].m == 0) {
-                                victim_page = eclock_hand_order[eclock_hand];
-                                found = 1;
-                                printf("victim_page_found1: %d\n", victim_page);
-                                printf("eclock_hand1found: %d\n", eclock_hand);
-                                eclock_hand = (eclock_hand + 1) % pm.size;
-                                break;
-                            } 
-                            eclock_hand = (eclock_hand + 1) % pm.size;
-                        }
-
-                        printf("eclock_hand2: %d\n", eclock_hand);
-
-                        // Step 2
-                        if (victim_page == -1) {
-                            for (int i = 0; i <= pm.size -1; i++){
-                                if (pt.entries[eclock_hand_order[eclock_hand]].r == 0 && pt.entries[eclock_hand_order[eclock_hand]].m == 1) {
-                                    victim_page = eclock_hand_order[eclock_hand];
-                                    found = 1;
-                                    printf("victim_page_found2: %d\n", victim_page);
-                                    printf("eclock_hand2found: %d\n", eclock_hand);
-                                    eclock_hand = (eclock_hand + 1) % pm.size;
-                                    break;
-                                } else if (pt.entries[eclock_hand_order[eclock_hand]].r == 1) {
-                                    pt.entries[eclock_hand_order[eclock_hand]].r = 0;
-                                }
-                                eclock_hand = (eclock_hand + 1) % pm.size;
-                            }
-                        }
-
-                        printf("eclock_hand3: %d\n", eclock_hand);
-
-                        // Step 3
-
-                        if (victim_page == -1) {
-                            for(int i = 0; i < pm.size-1; i++){
-                                if (pt.entries[eclock_hand_order[eclock_hand]].r == 0 && pt.entries[eclock_hand_order[eclock_hand]].m == 0) {
-                                    victim_page = eclock_hand_order[eclock_hand];
-                                    found = 1;
-                                    printf("victim_page_found3: %d\n", victim_page);
-                                    printf("eclock_hand3found: %d\n", eclock_hand);
-                                    eclock_hand = (eclock_hand + 1) % pm.size;
-                                    break;
-                                }
-                                eclock_hand = (eclock_hand + 1) % pm.size;
-                            }
-                        }
-                        
-                        printf("eclock_hand4: %d\n", eclock_hand);
-
-                        // Step 4
-
-                        if (victim_page == -1) {
-                            for(int i = 0; i < pm.size-1; i++){
-                                if (pt.entries[eclock_hand_order[eclock_hand]].r == 0 && pt.entries[eclock_hand_order[eclock_hand]].m == 1) {
-                                    victim_page = eclock_hand_order[eclock_hand];
-                                    found = 1;
-                                    printf("victim_page_found4: %d\n", victim_page);
-                                    printf("eclock_hand4found: %d\n", eclock_hand);
-                                    eclock_hand = (eclock_hand + 1) % pm.size;
-                                    break;
-                                }
-                                eclock_hand = (eclock_hand + 1) % pm.size; 
-                            }
-                        }
-
-                        printf("victim_page: %d\n", victim_page);
-
-                        // find the frame number associated with the victim page
-                        int victim_frame = pt.entries[victim_page].frame;
-                        printf("victim_frame: %d\n", victim_frame);
-
-                        // Write the victim page to the backing store if it is modified
-                        if (pt.entries[victim_page].m == 1) {
-                            fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                            fwrite(&pm.frames[victim_frame], sizeof(Frame), 1, swap_file);  // Write the page to the swap file
-                        }
-
-                        // Load the page from the backing store
-                        fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                        Page page;  // Page to be loaded
-                        fread(&page, sizeof(Page), 1, swap_file);  // Read the page from the swap file
-
-                        // Update the page table
-                        pt.entries[vpn].frame = victim_frame;
-                        pt.entries[vpn].r = 1;
-                        pt.entries[vpn].m = 0;
-                        pt.entries[vpn].v = 1;
-
-                        // update the physical memory
-                        for(int i = 1; i < PAGE_SIZE; i++) {
-                            pm.frames[victim_frame].data[i] = page.data[i];
-                        }
-
-                        // Update the ECLOCK order
-                        for (int i = 0; i < pm.size - 1; i++) {
-                            eclock_hand_order[i] = eclock_hand_order[i + 1];
-                        }
-
-                        eclock_hand_order[pm.size - 1] = vpn;
-
-                        pfn = victim_frame;
-                        pa = pfn * PAGE_SIZE + offset;                        
-                    } else {
-                        printf("Error: Wrong page replacement algorithm\n");
-                        exit(1);
-                    }
-
-                } else {
-                    // Empty frame found
-                    // Load the page into the empty frame
-                    printf("empty frame found\n");
-                    int empty_frame = next_empty_frame;
-                    next_empty_frame++;
-
-                    Frame frame;
-                    for(int i = 0; i < PAGE_SIZE; i++) {
-                        frame.data[i] = page.data[i];
-                    }
-                    pm.frames[empty_frame] = frame;
-                    // Update the page table
-                    printf("----------------vpn: %d\n", vpn);
-                    printf("empty_frame: %d\n", empty_frame);
-                    printf("pt.entries[vpn].frame: %d\n", pt.entries[vpn].frame);
-                    printf("pt.entries[vpn].r: %d\n", pt.entries[vpn].r);
-                    printf("pt.entries[vpn].m: %d\n", pt.entries[vpn].m);
-                    printf("pt.entries[vpn].v: %d\n", pt.entries[vpn].v);
-                    printf("----------------ref.addr: %d\n", ref.addr);
-                    pt.entries[vpn].frame = empty_frame;
-                    pt.entries[vpn].r = 1;
-                    pt.entries[vpn].m = 0;
-                    pt.entries[vpn].v = 1;
-                    // Update the physical frame number
-                    pfn = empty_frame;
-
-                    // Update the FIFO order
-                    for (int i = 0; i < pm.size - 1; i++) {
-                        fifo_order[i] = fifo_order[i + 1];
-                    }
-
-                    fifo_order[pm.size - 1] = vpn;
-                    
-                    // Update the LRU order, if vpn is already in the order, change its position to the first
-                    update_lru_order(vpn, pm.size, level);
-                }
-                
-            } else {
-                // Page hit
-                printf("Page hit\n");
-                // Update the R bit
-                pt.entries[vpn].r = 1;
-                // Update the physical frame number
-                printf("before pfn update\n");
-                printf("pfn: %d\n", pfn);
-                printf("pt.entries[vpn].frame: %d\n", pt.entries[vpn].frame);
-                pfn = pt.entries[vpn].frame;
-                // get the data
-                Frame frame = pm.frames[pfn];
-                printf("frame.data[offset]: %d\n", frame.data[offset]);
-                // Update the clock hand
-                clock_hand = (clock_hand + 1) % pm.size; // ADDED LATER
-                // Update the ECLOCK hand
-                // eclock_hand = (eclock_hand + 1) % pm.size; // ADDED LATER
-                // Update the LRU order, if vpn is already in the order, change its position to the first
-                update_lru_order(vpn, pm.size, level);
-            }
-            // Update the physical address
-            pa = pfn * PAGE_SIZE + offset;
-
-            // Write the data to the physical address if the memory reference is a write operation
-            if (ref.type == 'w') {
-                printf("writing to pm.frames[pfn].data[offset]: %d the value: %d\n", pm.frames[pfn].data[offset], ref.value); 
-                printf("pfn: %d\n", pfn);
-                printf("offset: %d\n", offset);
-                pm.frames[pfn].data[offset] = ref.value;
-                // Update the M bit
-                pt.entries[vpn].m = 1;
-            }
-        
-        } else if (level == 2) {
-            printf("level 2\n");
-            // Two-level paging
-            if (pt_array[pte1].entries == NULL) {
-                // initilize the inner page table
-                init_pt(&pt_array[pte1], level);
-            }
-
-            if (pt_array[pte1].entries[pte2].v == 0) {
-                // Page fault
-                pageFault = 1;
-                pfault_count++;
-                // Load the page from the backing store
-                fseek(swap_file, pte2 * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                Page page;  // Page to be loaded
-                fread(&page, sizeof(Page), 1, swap_file);  // Read the page from the swap file
-                
-                if (next_empty_frame >= pm.size) {
-                    printf("Error: No empty frame\n");
-                    // No empty frame
-                    // Page replacement
-                    if (strcmp(algo, "FIFO") == 0) {
-                        printf("FIFO algorithm runs\n");
-                        // FIFO
-                        // Select the victim page
-                        int victim_page = fifo_order[0];
-                        printf("victim_page: %d\n", victim_page);
-
-                        // find the frame number associated with the victim page
-                        int victim_frame = pt_array[pte1].entries[victim_page].frame;
-                        printf("victim_frame: %d\n", victim_frame);
-
-                        // Write the victim page to the backing store if it is modified
-                        if (pt_array[pte1].entries[victim_page].m == 1) {
-                            fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                            fwrite(&pm.frames[victim_frame], sizeof(Frame), 1, swap_file);  // Write the page to the swap file
-                        }
-
-                        // Load the page from the backing store
-                        fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                        Page page;  // Page to be loaded
-                        fread(&page, sizeof(Page), 1, swap_file);  // Read the page from the swap file
-
-                        // Update the page table
-                        pt_array[pte1].entries[pte2].frame = victim_frame;
-                        pt_array[pte1].entries[pte2].r = 1;
-                        pt_array[pte1].entries[pte2].m = 0;
-                        pt_array[pte1].entries[pte2].v = 1;
-
-                        // update the physical memory
-                        for(int i = 1; i < PAGE_SIZE; i++) {
-                            pm.frames[victim_frame].data[i] = page.data[i];
-                        }
-
-                        // Update the FIFO order
-                        for (int i = 0; i < pm.size - 1; i++) {
-                            fifo_order[i] = fifo_order[i + 1];
-                        }
-
-                        fifo_order[pm.size - 1] = pte2;
-                        pfn = victim_frame;
-                        pa = pfn * PAGE_SIZE + offset;
-
-                    } else if (strcmp(algo, "LRU") == 0) {
-                        printf("LRU algorithm runs\n");
-                        // LRU
-                        // Select the victim page
-                        int victim_page = lru_order[pm.size - 1];
-                        printf("victim_page: %d\n", victim_page);
-
-                        // find the frame number associated with the victim page
-                        int victim_frame = pt_array[pte1].entries[victim_page].frame;
-                        printf("victim_frame: %d\n", victim_frame);
-
-                        // Write the victim page to the backing store if it is modified
-                        if (pt_array[pte1].entries[victim_page].m == 1) {
-                            fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                            fwrite(&pm.frames[victim_frame], sizeof(Frame), 1, swap_file);  // Write the page to the swap file
-                        }
-
-                        // Load the page from the backing store
-                        fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                        Page page;  // Page to be loaded
-                        fread(&page, sizeof(Page), 1, swap_file);  // Read the page from the swap file
-
-                        // Update the page table
-                        pt_array[pte1].entries[pte2].frame = victim_frame;
-                        pt_array[pte1].entries[pte2].r = 1;
-                        pt_array[pte1].entries[pte2].m = 0;
-                        pt_array[pte1].entries[pte2].v = 1;
-
-                        // update the physical memory
-                        for(int i = 1; i < PAGE_SIZE; i++) {
-                            pm.frames[victim_frame].data[i] = page.data[i];
-                        }
-
-                        // Update the LRU order
-                        update_lru_order(pte2, pm.size, level);
-
-                        pfn = victim_frame;
-                        pa = pfn * PAGE_SIZE + offset;
-                    } else if (strcmp(algo, "CLOCK") == 0) {
-                        // CLOCK
-
-                        // Select the victim page
-                        int victim_page = -1;
-                        int found = 0;
-                        while (!found) {
-                            if (pt_array[pte1].entries[clock_hand_order[clock_hand]].r == 0) {
-                                victim_page = clock_hand_order[clock_hand];
-                                found = 1;
-                            } else {
-                                pt_array[pte1].entries[clock_hand_order[clock_hand]].r = 0;
-                                clock_hand = (clock_hand + 1) % pm.size;
-                            }
-                        }
-
-                        printf("victim_page: %d\n", victim_page);
-
-                        // find the frame number associated with the victim page
-                        int victim_frame = pt_array[pte1].entries[victim_page].frame;
-                        printf("victim_frame: %d\n", victim_frame);
-
-                        // Write the victim page to the backing store if it is modified
-                        if (pt_array[pte1].entries[victim_page].m == 1) {
-                            fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                            fwrite(&pm.frames[victim_frame], sizeof(Frame), 1, swap_file);  // Write the page to the swap file
-                        }
-
-                        // Load the page from the backing store
-                        fseek(swap_file, victim_page * PAGE_SIZE, SEEK_SET);  // Seek to the page in the swap file
-                        Page page;  // Page to be loaded
-                        fread(&page, sizeof(Page), 1, swap_file);  // Read the page from the swap file
-
-                        // Update the page table
-                        pt_array[pte1].entries[pte2].frame = victim_frame;
-                        pt_array[pte1].entries[pte2].r = 1;
-                        pt_array[pte1].entries[pte2].m = 0;
-                        pt_array[pte1].entries[pte2].v = 1;
-
-                        // update the physical memory
-                        for(int i = 1; i < PAGE_SIZE; i++) {
-                            pm.frames[victim_frame].data[i] = page.data[i];
-                        }
-
-                        // Update the CLOCK order
-                        for (int i = 0; i < pm.size - 1; i++) {
-                            clock_hand_order[i] = clock_hand_order[i + 1];
-                        }
-
-                        clock_hand_order[pm.size - 1] = pte2;
-
-                        pfn = victim_frame;
-                        pa = pfn * PAGE_SIZE + offset;
-                    } else if (strcmp(algo, "ECLOCK") == 0) {
-                        printf("ECLOCK algorithm runs\n");
-                        // ECLOCK
-                        
-                    } else {
-                        printf("Error: Wrong page replacement algorithm\n");
-                        exit(1);
-                    }
-
-                } else {
-                    // Empty frame found
-                    // Load the page into the empty frame
-                    printf("empty frame found\n");
-                    int empty_frame = next_empty_frame;
-                    next_empty_frame++;
-
-                    Frame frame;
-                    for(int i = 0; i < PAGE_SIZE; i++) {
-                        frame.data[i] = page.data[i];
-                    }
-                    pm.frames[empty_frame] = frame;
-                    // Update the page table
-                    printf("----------------pte2: %d\n", pte2);
-                    printf("empty_frame: %d\n", empty_frame);
-                    printf("pt_array[pte1].entries[pte2].frame: %d\n", pt_array[pte1].entries[pte2].frame);
-                    printf("pt_array[pte1].entries[pte2].r: %d\n", pt_array[pte1].entries[pte2].r);
-                    printf("pt_array[pte1].entries[pte2].m: %d\n", pt_array[pte1].entries[pte2].m);
-                    printf("pt_array[pte1].entries[pte2].v: %d\n", pt_array[pte1].entries[pte2].v);
-                    printf("----------------ref.addr: %d\n", ref.addr);
-                    pt_array[pte1].entries[pte2].frame = empty_frame;
-                    pt_array[pte1].entries[pte2].r = 1;
-                    pt_array[pte1].entries[pte2].m = 0;
-                    pt_array[pte1].entries[pte2].v = 1;
-                    // Update the physical frame number
-                    pfn = empty_frame;
-
-                    // Update the FIFO order
-                    for (int i = 0; i < pm.size - 1; i++) {
-                        fifo_order[i] = fifo_order[i + 1];
-                    }
-
-                    fifo_order[pm.size - 1] = pte2;
-                    
-                    // Update the LRU order, if vpn is already in the order, change its position to the first
-                    update_lru_order(pte2, pm.size, level);
-                }
-                
-            } else {
-                // Page hit
-                // Update the R bit
-                pt_array[pte1].entries[pte2].r = 1;
-                // Update the physical frame number
-                pfn = pt_array[pte1].entries[pte2].frame;
-                // get the data
-                Frame frame = pm.frames[pfn];
-                printf("frame.data[offset]: %d\n", frame.data[offset]);
-                // Update the clock hand
-                clock_hand = (clock_hand + 1) % pm.size; // ADDED LATER
-
-                // Update the LRU order, if vpn is already in the order, change its position to the first
-                update_lru_order(pte2, pm.size, level);
-            }
-            // Update the physical address
-            pa = pfn * PAGE_SIZE + offset;
-            
-            // Write the data to the physical address if the memory reference is a write operation
-            if (ref.type == 'w') {
-                printf("writing to pm.frames[pfn].data[offset]: %d the value: %d\n", pm.frames[pfn].data[offset], ref.value); 
-                printf("pfn: %d\n", pfn);
-                printf("offset: %d\n", offset);
-                pm.frames[pfn].data[offset] = ref.value;
-                // Update the M bit
-                pt_array[pte1].entries[pte2].m = 1;
-            }
-            
-        } else {
-            printf("Error: Wrong number of levels in the page table\n");
-            exit(1);
-        }
-
-        // Write the physical address and the phyiscal frame number to the output file
-        fprintf(out_file, "PFN:0x%x PA:0x%04x ", pfn, pa);
-        
-        // Write the page fault flag to the output file
-        if(pageFault == 1){
-            fprintf(out_file, "pgfault\n");
-        }else{
-            fprintf(out_file, " \n");
-        }
+    // Open the address file, the memory references are streamed from it in chunks
+    Trace trace;
+    trace_open(&trace, addrfile);
+    check_config(&trace);
 
+    if (mrc_mode >= 0) {
+        run_mrc(&trace);
+    } else if (sweep_threads < 0) {
+        run_single(&trace);
+    } else {
+        run_sweep(&trace);
     }
-
-    // Write the page fault counter to the output file
-    fprintf(out_file, "%d\n", pfault_count);
-
-    // Write the physical memory to the backing store
-    write_pm_to_swap(&pm);
-
-    // close the output file
-    fclose(out_file);
-
-    // Free the memory
-    free(refs);
-    free(pt.entries);
-    free(pm.frames);
-    free(vm.pages);
+    trace_close(&trace);
 
     // Return
     return 0;
@@ -799,185 +88,511 @@ int main(int argc, char *argv[]) {
 
 // Read the command line arguments
 void read_args(int argc, char *argv[]) {
-    // Check the number of arguments
-    if (argc != 15) {
-        printf("Error: Wrong number of arguments\n");
-        exit(1);
+    // Check the number of arguments, every option has a value
+    if (argc < 3 || argc % 2 == 0) {
+        fatal("Wrong number of arguments");
     }
     // Read the arguments
     for (int i = 1; i < argc; i += 2) {
         if (strcmp(argv[i], "-p") == 0) {
-            level = atoi(argv[i + 1]);
+            level_count = parse_int_list(argv[i + 1], levels);
+        } else if (strcmp(argv[i], "-g") == 0) {
+            cfg.page_size = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-H") == 0) {
+            cfg.huge = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-x") == 0) {
+            cfg.va_bits = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-b") == 0) {
+            strcpy(bits_spec, argv[i + 1]);
         } else if (strcmp(argv[i], "-r") == 0) {
             strcpy(addrfile, argv[i + 1]);
         } else if (strcmp(argv[i], "-s") == 0) {
             strcpy(swapfile, argv[i + 1]);
         } else if (strcmp(argv[i], "-f") == 0) {
-            fcount = atoi(argv[i + 1]);
+            fcount_count = parse_int_list(argv[i + 1], fcounts);
         } else if (strcmp(argv[i], "-a") == 0) {
-            strcpy(algo, argv[i + 1]);
+            algo_count = parse_name_list(argv[i + 1], algos);
+        } else if (strcmp(argv[i], "-l") == 0) {
+            if (strcmp(argv[i + 1], "global") == 0) {
+                cfg.local_repl = 0;
+            } else if (strcmp(argv[i + 1], "local") == 0) {
+                cfg.local_repl = 1;
+            } else {
+                fatal("Wrong replacement scope, use global or local");
+            }
         } else if (strcmp(argv[i], "-t") == 0) {
-            tick = atoi(argv[i + 1]);
+            cfg.tick = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-W") == 0) {
+            cfg.ws_window = atoi(argv[i + 1]);
         } else if (strcmp(argv[i], "-o") == 0) {
             strcpy(outfile, argv[i + 1]);
+        } else if (strcmp(argv[i], "-m") == 0) {
+            out_mode = output_mode(argv[i + 1]);
+        } else if (strcmp(argv[i], "-i") == 0) {
+            cfg.io_mode = bs_mode(argv[i + 1]);
+        } else if (strcmp(argv[i], "-w") == 0) {
+            cfg.wb_depth = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-c") == 0) {
+            cfg.clean_batch = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-R") == 0) {
+            cfg.ra_window = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "-T") == 0) {
+            // entries[:ways[:policy]]
+            char repl[16] = "lru";
+            if (sscanf(argv[i + 1], "%d:%d:%15s", &cfg.tlb_size, &cfg.tlb_ways, repl) < 1) {
+                fatal("Wrong TLB configuration %s", argv[i + 1]);
+            }
+            cfg.tlb_policy = tlb_repl(repl);
+        } else if (strcmp(argv[i], "-S") == 0) {
+            sweep_threads = atoi(argv[i + 1]);
+            if (sweep_threads < 0) {
+                fatal("Wrong number of sweep threads");
+            }
+        } else if (strcmp(argv[i], "-J") == 0) {
+            // file[:every]
+            split_option(argv[i + 1], statsfile, sizeof(statsfile), &stats_every);
+            if (stats_every < 0) {
+                fatal("Wrong statistics file %s", argv[i + 1]);
+            }
+        } else if (strcmp(argv[i], "-B") == 0) {
+            strcpy(benchfile, argv[i + 1]);
+        } else if (strcmp(argv[i], "-M") == 0) {
+            char mode[16] = "";
+            split_option(argv[i + 1], mode, sizeof(mode), &mrc_budget);
+            if (mrc_budget < 64) {
+                fatal("Wrong miss-ratio curve mode %s", argv[i + 1]);
+            }
+            if (strcmp(mode, "exact") == 0) {
+                mrc_mode = MRC_EXACT;
+            } else if (strcmp(mode, "shards") == 0) {
+                mrc_mode = MRC_SHARDS;
+            } else if (strcmp(mode, "both") == 0) {
+                mrc_mode = MRC_BOTH;
+            } else {
+                fatal("Wrong miss-ratio curve mode, use exact, shards[:pages] or both[:pages]");
+            }
+        } else if (strcmp(argv[i], "-v") == 0) {
+            log_init(atoi(argv[i + 1]));
         } else {
-            printf("Error: Wrong argument\n");
-            exit(1);
+            fatal("Wrong argument");
+        }
+    }
+    // A miss-ratio curve is always LRU's and touches no swap file
+    if (mrc_mode >= 0) {
+        if (sweep_threads >= 0) {
+            fatal("A miss-ratio curve (-M) covers every frame count already, drop -S");
+        }
+        if (algo_count == 0) {
+            algo_count = parse_name_list("LRU", algos);
+        }
+        if (cfg.tick == 0) {
+            cfg.tick = 1;
         }
     }
     // Check the arguments
-    if (level < 1 || level > 2) {
-        printf("Error: Wrong number of levels in the page table\n");
-        exit(1);
-    }
-    if (fcount < 4 || fcount > 128) {
-        printf("Error: Wrong number of frames in the physical memory\n");
-        exit(1);
-    }
-    if (strcmp(algo, "FIFO") != 0 && strcmp(algo, "LRU") != 0 && strcmp(algo, "CLOCK") != 0 && strcmp(algo, "ECLOCK") != 0) {
-        printf("Error: Wrong page replacement algorithm\n");
-        exit(1);
-    }
-
-    printf("level = %d\n", level);
-    printf("addrfile = %s\n", addrfile);
-    printf("swapfile = %s\n", swapfile);
-    printf("fcount = %d\n", fcount);
-    printf("algo = %s\n", algo);
-    printf("tick = %d\n", tick);
-    printf("outfile = %s\n", outfile);
+    if (addrfile[0] == '\0' || (swapfile[0] == '\0' && mrc_mode < 0) || outfile[0] == '\0') {
+        fatal("Missing argument");
+    }
+    if (level_count == 0 || fcount_count == 0 || algo_count == 0) {
+        fatal("Missing argument");
+    }
+    if (out_mode < 0) {
+        fatal("Wrong output mode");
+    }
+    if (sweep_threads < 0 && (level_count > 1 || fcount_count > 1 || algo_count > 1)) {
+        fatal("Lists of levels, frame counts or algorithms need a sweep (-S)");
+    }
+    if (statsfile[0] != '\0' && (sweep_threads >= 0 || mrc_mode >= 0)) {
+        fatal("Detailed statistics (-J) come from a single simulation, drop -S and -M");
+    }
+    if (benchfile[0] != '\0' && sweep_threads < 0) {
+        fatal("Benchmark results (-B) come from a sweep (-S)");
+    }
+    if (sweep_threads >= 0) {
+        if (cfg.wb_depth > 0) {
+            fatal("Sweeps write back synchronously, drop -w");
+        }
+        cfg.io_mode = BS_MEM;  // the runs share the swap file and keep their changes to themselves
+    }
 }
 
-// Read the memory references (virtual addresses) from the address file
-void read_refs(char *addrfile, Ref *refs, int *ref_count) {
-    FILE *addr_file = fopen(addrfile, "r");  // Open the address file in read mode
-    if (addr_file == NULL) {
-        printf("Error: Address file does not exist\n");
-        exit(1);
-    }
-
-    char line[64];  // Line of the address file
-    int i = 0;  // Index of the array of memory references
-    while (fgets(line, sizeof(line), addr_file)) {
-        if (line[0] == 'r') {
-            refs[i].type = 'r';
-            sscanf(line, "%*c %x", &refs[i].addr);
-        } else if (line[0] == 'w') {
-            refs[i].type = 'w';
-            sscanf(line, "%*c %x %x", &refs[i].addr, &refs[i].value);
-        } else {
-            printf("Error: Wrong memory reference type\n");
-            exit(1);
+// Fit the address width to the trace, then check the configuration and log it
+void check_config(const Trace *trace) {
+    // Without -x the addresses are as wide as the trace header says, rounded up to a width the page tables support
+    if (cfg.va_bits == 0) {
+        cfg.va_bits = trace_va_bits(trace->addr_bits);
+        if (cfg.va_bits == 0) {
+            fatal("The trace has %d bit addresses, at most 48 are supported", trace->addr_bits);
         }
-        i++;
+    } else if (cfg.va_bits < trace->addr_bits) {
+        fatal("The trace has %d bit addresses, they do not fit in -x %d", trace->addr_bits, cfg.va_bits);
+    }
+    if (trace->page_size != 0 && trace->page_size != cfg.page_size) {
+        LOG_WARN("trace was recorded with %d byte pages, simulating %d byte pages", trace->page_size, cfg.page_size);
     }
-    *ref_count = i;  // Set the number of memory references
-
-    fclose(addr_file);  // Close the address file
 
-    printf("ref_count = %d\n", *ref_count);
+    // A sweep checks each of its combinations before any of them runs
+    cfg.level = levels[0];
+    cfg.fcount = fcounts[0];
+    strcpy(cfg.algo, algos[0]);
+    sim_config_check(&cfg, bits_spec);
 
-    // Print the memory references
-    for (int i = 0; i < *ref_count; i++) {
-        printf("%c %x %x\n", refs[i].type, refs[i].addr, refs[i].value);
+    if (mrc_mode >= 0) {
+        LOG_INFO("miss-ratio curve of %s for 1 to %d frames of %d bytes", addrfile,
+                 cfg.fcount / (cfg.map_size / cfg.page_size), cfg.map_size);
+        return;
     }
-}    
-
-// Initialize the page table
-void init_pt(PT *pt, int levels) {
-    pt->size = (1 << (10 - 2 * (levels - 1)));
-    pt->entries = malloc(pt->size * sizeof(PTE));
-    for (int i = 0; i < pt->size; i++) {
-        pt->entries[i].frame = 0;
-        pt->entries[i].r = 0;
-        pt->entries[i].m = 0;
-        pt->entries[i].v = 0;
+    if (sweep_threads >= 0) {
+        LOG_INFO("sweep of %d levels x %d frame counts x %d algorithms", level_count, fcount_count, algo_count);
+        return;
     }
+    LOG_INFO("level = %d", cfg.level);
+    LOG_INFO("virtual addresses = %d bits, %d levels of %d/%d/%d/%d index bits", cfg.va_bits, cfg.level,
+             cfg.level_bits[0], cfg.level_bits[1], cfg.level_bits[2], cfg.level_bits[3]);
+    LOG_INFO("addrfile = %s", addrfile);
+    LOG_INFO("swapfile = %s", swapfile);
+    LOG_INFO("page size = %d, mapped in %d byte pages", cfg.page_size, cfg.map_size);
+    LOG_INFO("fcount = %d", cfg.fcount);
+    LOG_INFO("algo = %s, %s replacement", cfg.algo, cfg.local_repl ? "local" : "global");
+    LOG_INFO("tick = %d", cfg.tick);
+    LOG_INFO("outfile = %s", outfile);
+    LOG_INFO("output mode = %s", out_mode == OUT_TEXT ? "text" : out_mode == OUT_BINARY ? "binary" : "summary");
 }
 
-// Initialize the physical memory
-void init_pm(PM *pm) {
-    pm->size = fcount;
-    pm->frames = malloc(pm->size * PAGE_SIZE);
-    for (int i = 0; i < pm->size; i++) {
-        for (int j = 0; j < PAGE_SIZE; j++) {
-            pm->frames[i].data[j] = 0;
+// Parse a comma separated list of numbers and lo-hi[:step] ranges, returns the number of values
+int parse_int_list(const char *spec, int *values) {
+    int n = 0;
+    const char *p = spec;
+    while (*p != '\0') {
+        char *end;
+        long lo = strtol(p, &end, 10);
+        long hi = lo;
+        long step = 1;
+        if (end == p) {
+            fatal("Wrong list %s", spec);
         }
-        clock_hand_order[i] = i;
-        eclock_hand_order[i] = i;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtol(p, &end, 10);
+            if (*end == ':') {
+                p = end + 1;
+                step = strtol(p, &end, 10);
+            }
+            if (end == p || hi < lo || step < 1) {
+                fatal("Wrong range in %s", spec);
+            }
+        }
+        for (long v = lo; v <= hi; v += step) {
+            if (n == MAX_SWEEP) {
+                fatal("%s has more than %d values", spec, MAX_SWEEP);
+            }
+            values[n++] = (int)v;
+        }
+        if (*end != ',' && *end != '\0') {
+            fatal("Wrong list %s", spec);
+        }
+        p = (*end == ',') ? end + 1 : end;
     }
+    return n;
 }
 
-// Initialize the virtual memory
-void init_vm(VM *vm, int levels) {
-    vm->size = (1 << (10 - 2 * (levels - 1)));
-    vm->pages = malloc(vm->size * PAGE_SIZE);
-    for (int i = 0; i < vm->size; i++) {
-        for (int j = 0; j < PAGE_SIZE; j++) {
-            vm->pages[i].data[j] = 0;
+// Parse a comma separated list of names, returns the number of names
+int parse_name_list(const char *spec, char names[][64]) {
+    int n = 0;
+    const char *p = spec;
+    while (*p != '\0') {
+        size_t len = strcspn(p, ",");
+        if (len == 0 || len >= 64) {
+            fatal("Wrong list %s", spec);
+        }
+        if (n == MAX_SWEEP) {
+            fatal("%s has more than %d values", spec, MAX_SWEEP);
+        }
+        memcpy(names[n], p, len);
+        names[n++][len] = '\0';
+        p += len;
+        if (*p == ',') {
+            p++;
         }
     }
+    return n;
 }
 
-// Initialize the backing store, create it if doesn't exist and initialize it to all 0s
-void init_bs(char *swapfile) {
-    FILE *swap_file = fopen(swapfile, "rb");  // Open the swap file in write mode
-    if (swap_file == NULL) {
-        // Create the swap file
-        swap_file = fopen(swapfile, "wb");  // Open the swap file in write mode
-        for (int i = 0; i < 1024; i++) {
-            Page page;
-            for (int j = 0; j < PAGE_SIZE; j++) {
-                page.data[j] = 0;
+// Split a name[:number] option at its last ':' if a number follows it, returns 1 if there was a number
+int split_option(const char *spec, char *name, size_t size, long *number) {
+    // A name can hold ':' itself, only a number after the last one is split off
+    const char *colon = strrchr(spec, ':');
+    char *end = NULL;
+    long value = 0;
+    if (colon != NULL && colon[1] != '\0') {
+        value = strtol(colon + 1, &end, 10);
+    }
+    int numeric = (end != NULL && *end == '\0');
+    size_t len = numeric ? (size_t)(colon - spec) : strlen(spec);
+    if (len == 0 || len >= size) {
+        fatal("Wrong option %s", spec);
+    }
+    memcpy(name, spec, len);
+    name[len] = '\0';
+    if (numeric) {
+        *number = value;
+    }
+    return numeric;
+}
+
+// Run one simulation and write a line per reference to the output file
+void run_single(Trace *trace) {
+    // An offline policy looks ahead, so it gets the whole trace decoded up front with its next-use index
+    Ref *refs = NULL;
+    long *next_use = NULL;
+    long ref_count = 0;
+    if (policy_lookup(cfg.algo)->offline) {
+        ref_count = trace_load(trace, &refs);
+        next_use = trace_next_use(refs, ref_count, cfg.map_shift);
+    }
+
+    Sim sim;
+    sim_init(&sim, &cfg, swapfile, next_use);
+    if (statsfile[0] != '\0') {
+        sim_stats_open(&sim, statsfile, stats_every);
+    }
+
+    // Open the output file in write mode
+    Writer out;
+    writer_open(&out, outfile, out_mode);
+
+    // simulating the memory references, otherwise decoded one chunk at a time
+    if (refs != NULL) {
+        for (long i = 0; i < ref_count; i++) {
+            sim_ref(&sim, &refs[i], &out);
+        }
+    } else {
+        refs = malloc(TRACE_CHUNK * sizeof(Ref));  // Buffer for one chunk of memory references
+        if (refs == NULL) {
+            fatal("Cannot allocate the trace buffer");
+        }
+        for (;;) {
+            PROF_START(parse);
+            int n = trace_next(trace, refs, TRACE_CHUNK);
+            PROF_STOP(&sim.prof, PROF_PARSE, parse);
+            if (n <= 0) {
+                break;
+            }
+            for (int i = 0; i < n; i++) {
+                sim_ref(&sim, &refs[i], &out);
             }
-            fwrite(&page, sizeof(Page), 1, swap_file);
         }
     }
+    LOG_INFO("ref_count = %ld", sim.ref_count);
 
-    fclose(swap_file);  // Close the swap file
+    // Write the page fault counter to the output file and close it
+    writer_close(&out, sim.pfault_count);
+
+    // Write the physical memory to the backing store
+    sim_finish(&sim);
+    sim_report(&sim);
+
+    // Free the memory
+    free(refs);
+    free(next_use);
+    sim_free(&sim);
 }
 
-// Write the physical memory to the backing store
-void write_pm_to_swap(PM *pm) {
-    FILE *swap_file = fopen(swapfile, "rb+");  // Open the swap file in read/write mode
-    if (swap_file == NULL) {
-        printf("Error: Swap file does not exist\n");
-        exit(1);
+// Run every combination of levels, frame counts and algorithms and write the page fault ratio matrix
+void run_sweep(Trace *trace) {
+    // Decode the trace once, every run reads the same references
+    Ref *refs;
+    long ref_count = trace_load(trace, &refs);
+
+    // One run per cell, rows are (level, algorithm) pairs and columns frame counts. All of them are checked before
+    // the first one starts.
+    int count = level_count * algo_count * fcount_count;
+    SweepRun *runs = malloc(count * sizeof(SweepRun));
+    if (runs == NULL) {
+        fatal("Cannot allocate %d sweep runs", count);
+    }
+    int i = 0;
+    for (int l = 0; l < level_count; l++) {
+        for (int a = 0; a < algo_count; a++) {
+            for (int f = 0; f < fcount_count; f++) {
+                runs[i].cfg = cfg;
+                runs[i].cfg.level = levels[l];
+                runs[i].cfg.fcount = fcounts[f];
+                strcpy(runs[i].cfg.algo, algos[a]);
+                sim_config_check(&runs[i].cfg, bits_spec);
+                runs[i].next_use = NULL;
+                runs[i].faults = 0;
+                i++;
+            }
+        }
     }
 
-    for (int i = 0; i < pm->size; i++) {
-        fwrite(&pm->frames[i], sizeof(Frame), 1, swap_file);
+    // Offline policies share one next-use index per mapping size, which only huge pages vary
+    long *next_use[64] = {NULL};
+    for (int r = 0; r < count; r++) {
+        int shift = runs[r].cfg.map_shift;
+        if (policy_lookup(runs[r].cfg.algo)->offline) {
+            if (next_use[shift] == NULL) {
+                next_use[shift] = trace_next_use(refs, ref_count, shift);
+            }
+            runs[r].next_use = next_use[shift];
+        }
     }
 
-    fclose(swap_file);  // Close the swap file
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sweep_run(runs, count, refs, ref_count, swapfile, sweep_threads);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    LOG_INFO("sweep: %d runs of %ld references in %.2f s", count, ref_count,
+             (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+    // Write the page fault ratio of each run, the hit ratio is 1 minus it
+    FILE *out = fopen(outfile, "w");
+    if (out == NULL) {
+        fatal("Cannot create %s", outfile);
+    }
+    fprintf(out, "level,algo");
+    for (int f = 0; f < fcount_count; f++) {
+        fprintf(out, ",%d", fcounts[f]);
+    }
+    fprintf(out, "\n");
+    for (int r = 0; r < count; r += fcount_count) {
+        fprintf(out, "%d,%s", runs[r].cfg.level, runs[r].cfg.algo);
+        for (int f = 0; f < fcount_count; f++) {
+            fprintf(out, ",%.6f", ref_count > 0 ? (double)runs[r + f].faults / ref_count : 0.0);
+        }
+        fprintf(out, "\n");
+    }
+    fclose(out);
+
+    if (benchfile[0] != '\0') {
+        write_bench(runs, count, ref_count);
+    }
+
+    for (int shift = 0; shift < 64; shift++) {
+        free(next_use[shift]);
+    }
+    free(runs);
+    free(refs);
 }
 
-// update the LRU order
-void update_lru_order(int vpn, int pm_size, int levels) {
-    // if vpn is already in the order, change its position to the first
-    int index = -1;
-    for (int i = 0; i < pm_size; i++) {
-        if (lru_order[i] == vpn) {
-            index = i;
-            break;
-        }
+// Append one line per sweep run with its fault ratio, swap I/O and throughput to the benchmark file
+void write_bench(const SweepRun *runs, int count, long ref_count) {
+    FILE *out = fopen(benchfile, "a");
+    if (out == NULL) {
+        fatal("Cannot open %s", benchfile);
+    }
+    // Several sweeps can append to the same file, only the first one writes the header
+    fseek(out, 0, SEEK_END);
+    if (ftell(out) == 0) {
+        fprintf(out, "trace,level,algo,frames,refs,faults,fault_ratio,page_ins,page_outs,seconds,refs_per_sec,"
+                     "ns_per_ref\n");
     }
-    if (index != -1) {
-        for (int i = index; i > 0; i--) {
-            lru_order[i] = lru_order[i - 1];
+    for (int r = 0; r < count; r++) {
+        const SweepRun *run = &runs[r];
+        double seconds = (run->seconds > 0) ? run->seconds : 1e-9;
+        fprintf(out, "%s,%d,%s,%d,%ld,%ld,%.6f,%ld,%ld,%.6f,%.0f,%.2f\n", addrfile, run->cfg.level, run->cfg.algo,
+                run->cfg.fcount, ref_count, run->faults, ref_count > 0 ? (double)run->faults / ref_count : 0.0,
+                run->page_ins, run->page_outs, run->seconds, ref_count / seconds,
+                ref_count > 0 ? run->seconds * 1e9 / ref_count : 0.0);
+    }
+    fclose(out);
+}
+
+// Compute the LRU page faults of every memory size up to fcount in one pass and write them to the output file
+void run_mrc(Trace *trace) {
+    int frames = cfg.fcount / (cfg.map_size / cfg.page_size);  // frames of the size of a mapping
+    Mrc exact;
+    Mrc sample;
+    if (mrc_mode != MRC_SHARDS) {
+        mrc_init(&exact, frames, 0);
+    }
+    if (mrc_mode != MRC_EXACT) {
+        mrc_init(&sample, frames, mrc_budget);
+    }
+    long ref_count = 0;
+
+    Ref *refs = malloc(TRACE_CHUNK * sizeof(Ref));  // Buffer for one chunk of memory references
+    if (refs == NULL) {
+        fatal("Cannot allocate the trace buffer");
+    }
+    int n;
+    while ((n = trace_next(trace, refs, TRACE_CHUNK)) > 0) {
+        for (int i = 0; i < n; i++) {
+            if ((refs[i].addr >> cfg.va_bits) != 0) {
+                fatal("Address 0x%llx of reference %ld is outside the %d bit address space",
+                      (unsigned long long)refs[i].addr, ref_count, cfg.va_bits);
+            }
+            // Page numbers have at most 42 bits, the process ID goes above them
+            uint64_t key = ((uint64_t)refs[i].pid << 48) | (refs[i].addr >> cfg.map_shift);
+            if (mrc_mode != MRC_SHARDS) {
+                mrc_access(&exact, key);
+            }
+            if (mrc_mode != MRC_EXACT) {
+                mrc_access(&sample, key);
+            }
+            ref_count++;
         }
-        lru_order[0] = vpn;
+    }
+    free(refs);
+
+    long *faults = malloc((frames + 1) * sizeof(long));
+    long *exact_faults = malloc((frames + 1) * sizeof(long));
+    if (faults == NULL || exact_faults == NULL) {
+        fatal("Cannot allocate the miss-ratio curve");
+    }
+    if (mrc_mode != MRC_SHARDS) {
+        LOG_INFO("mrc: %ld references, %ld distinct pages, %zu bytes of analysis state", exact.refs, exact.pages,
+                 mrc_bytes(&exact));
+        mrc_curve(&exact, exact_faults);
+        memcpy(faults, exact_faults, (frames + 1) * sizeof(long));
+    }
+    if (mrc_mode != MRC_EXACT) {
+        LOG_INFO("mrc: sampled %ld of %ld references at rate %.6f, %zu bytes of analysis state", sample.sampled,
+                 sample.refs, 1.0 / sample.weight, mrc_bytes(&sample));
+        mrc_curve(&sample, faults);
+    }
+
+    // One line per memory size, with the error of the sample next to the exact curve if both ran
+    FILE *out = fopen(outfile, "w");
+    if (out == NULL) {
+        fatal("Cannot create %s", outfile);
+    }
+    double total = (ref_count > 0) ? (double)ref_count : 1.0;
+    double error_sum = 0;
+    double error_max = 0;
+    int error_max_frames = 0;
+    if (mrc_mode == MRC_BOTH) {
+        fprintf(out, "frames,faults,fault_ratio,exact_faults,exact_fault_ratio,error\n");
     } else {
-        // if vpn is not in the order, add it to the first position
-        for (int i = pm_size - 1; i > 0; i--) {
-            lru_order[i] = lru_order[i - 1];
+        fprintf(out, "frames,faults,fault_ratio\n");
+    }
+    for (int f = 1; f <= frames; f++) {
+        fprintf(out, "%d,%ld,%.6f", f, faults[f], faults[f] / total);
+        if (mrc_mode == MRC_BOTH) {
+            double error = (faults[f] - exact_faults[f]) / total;
+            fprintf(out, ",%ld,%.6f,%+.6f", exact_faults[f], exact_faults[f] / total, error);
+            error = (error < 0) ? -error : error;
+            error_sum += error;
+            if (error > error_max) {
+                error_max = error;
+                error_max_frames = f;
+            }
         }
-        lru_order[0] = vpn;
+        fprintf(out, "\n");
     }
-    // print the LRU order
-    printf("lru_order after simulation:\n");
-    for (int i = 0; i < pm_size; i++) {
-        printf("lru_order[%d]: %d\n", i, lru_order[i]);
+    fclose(out);
+    if (mrc_mode == MRC_BOTH) {
+        LOG_INFO("mrc: sampled curve off by %.6f on average, at most %.6f with %d frames", error_sum / frames,
+                 error_max, error_max_frames);
     }
-}
 
+    free(faults);
+    free(exact_faults);
+    if (mrc_mode != MRC_SHARDS) {
+        mrc_free(&exact);
+    }
+    if (mrc_mode != MRC_EXACT) {
+        mrc_free(&sample);
+    }
+}
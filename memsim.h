@@ -0,0 +1,32 @@
+#ifndef MEMSIM_H
+#define MEMSIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Frame numbers must fit in the frame field of a PTE
+#define MAX_FRAMES (1 << 30)
+
+// Structs
+
+// Page table entry, the R and M bits of resident pages live in the frame table
+typedef struct { // 32 bits --> frame number or swap slot, swap bit, valid bit
+    uint32_t frame : 30; // Frame number if the page is resident, else its swap slot if s is set
+    uint32_t s : 1;      // Swap bit: a non-resident page has a slot in the backing store
+    uint32_t v : 1;      // Valid bit
+} PTE;
+
+// Physical memory, frames of frame_size bytes stored back to back
+typedef struct {
+    uint8_t *frames; // contents of all the frames
+    int size; // size of the physical memory in frames
+    int frame_size; // size of each frame in bytes
+} PM;
+
+
+// Contents of a frame
+static inline uint8_t *frame_data(PM *pm, int frame) {
+    return pm->frames + (size_t)frame * pm->frame_size;
+}
+
+#endif
@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "mrc.h"
+
+// Free entry of the hash table, no page key has every bit set
+#define MRC_EMPTY UINT64_MAX
+
+// Hash table entry where the search for a page starts
+static long mrc_home(const Mrc *mrc, uint64_t key) {
+    return (long)((key * 0x9E3779B97F4A7C15ull) >> 20) & (mrc->cap - 1);
+}
+
+// Hash table entry of a page: its own entry if present, else the free entry where it would go
+static long mrc_slot(const Mrc *mrc, uint64_t key) {
+    long i = mrc_home(mrc, key);
+    while (mrc->keys[i] != MRC_EMPTY && mrc->keys[i] != key) {
+        i = (i + 1) & (mrc->cap - 1);
+    }
+    return i;
+}
+
+// Double the hash table once it is half full
+static void mrc_grow_table(Mrc *mrc) {
+    uint64_t *keys = mrc->keys;
+    long *last = mrc->last;
+    long cap = mrc->cap;
+    mrc->cap *= 2;
+    mrc->keys = malloc(mrc->cap * sizeof(uint64_t));
+    mrc->last = malloc(mrc->cap * sizeof(long));
+    if (mrc->keys == NULL || mrc->last == NULL) {
+        fatal("Out of memory for the stack distance table");
+    }
+    memset(mrc->keys, 0xff, mrc->cap * sizeof(uint64_t));
+    for (long i = 0; i < cap; i++) {
+        if (keys[i] != MRC_EMPTY) {
+            long j = mrc_slot(mrc, keys[i]);
+            mrc->keys[j] = keys[i];
+            mrc->last[j] = last[i];
+        }
+    }
+    free(keys);
+    free(last);
+}
+
+// Free an entry of the hash table, moving back the entries after it that could not go to their home entry
+static void mrc_remove(Mrc *mrc, long i) {
+    for (long j = (i + 1) & (mrc->cap - 1); mrc->keys[j] != MRC_EMPTY; j = (j + 1) & (mrc->cap - 1)) {
+        // The entry at j may fill the hole at i unless its home lies after i on the way to j
+        long home = mrc_home(mrc, mrc->keys[j]);
+        if (((j - home) & (mrc->cap - 1)) >= ((j - i) & (mrc->cap - 1))) {
+            mrc->keys[i] = mrc->keys[j];
+            mrc->last[i] = mrc->last[j];
+            i = j;
+        }
+    }
+    mrc->keys[i] = MRC_EMPTY;
+}
+
+// Hash of a page that decides whether it is sampled, unrelated to its hash table entry
+static uint64_t sample_hash(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ull;
+    key ^= key >> 33;
+    return key & ((1ull << MRC_HASH_BITS) - 1);
+}
+
+// Add a sampled page to the heap
+static void heap_push(Mrc *mrc, uint64_t key) {
+    long i = mrc->pages - 1;  // the page is already counted
+    uint64_t hash = sample_hash(key);
+    while (i > 0 && sample_hash(mrc->heap[(i - 1) / 2]) < hash) {
+        mrc->heap[i] = mrc->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    mrc->heap[i] = key;
+}
+
+// Remove the sampled page with the largest hash from the heap of n pages
+static uint64_t heap_pop(Mrc *mrc, long n) {
+    uint64_t top = mrc->heap[0];
+    uint64_t key = mrc->heap[--n];
+    uint64_t hash = sample_hash(key);
+    long i = 0;
+    while (2 * i + 1 < n) {
+        long child = 2 * i + 1;
+        if (child + 1 < n && sample_hash(mrc->heap[child + 1]) > sample_hash(mrc->heap[child])) {
+            child++;
+        }
+        if (sample_hash(mrc->heap[child]) <= hash) {
+            break;
+        }
+        mrc->heap[i] = mrc->heap[child];
+        i = child;
+    }
+    mrc->heap[i] = key;
+    return top;
+}
+
+// Add delta at time t of the Fenwick tree
+static void tree_add(Mrc *mrc, long t, int delta) {
+    for (; t <= mrc->size; t += t & -t) {
+        mrc->tree[t] += delta;
+    }
+}
+
+// Sum of the Fenwick tree over times 1..t
+static long tree_sum(const Mrc *mrc, long t) {
+    long sum = 0;
+    for (; t > 0; t -= t & -t) {
+        sum += mrc->tree[t];
+    }
+    return sum;
+}
+
+// Renumber the last references 1..pages in time order and make room for as many references again
+static void mrc_renumber(Mrc *mrc) {
+    long n = 0;
+    for (long t = 1; t < mrc->now; t++) {
+        uint64_t key = mrc->key_at[t];
+        long i = mrc_slot(mrc, key);
+        if (mrc->keys[i] == key && mrc->last[i] == t) {
+            mrc->key_at[++n] = key;  // n <= t, so the entries still to be read are untouched
+            mrc->last[i] = n;
+        }
+    }
+
+    long size = 2 * n + 1024;
+    if (size != mrc->size) {
+        mrc->size = size;
+        mrc->tree = realloc(mrc->tree, (size + 1) * sizeof(int));
+        mrc->key_at = realloc(mrc->key_at, (size + 1) * sizeof(uint64_t));
+        if (mrc->tree == NULL || mrc->key_at == NULL) {
+            fatal("Out of memory for the stack distance tree");
+        }
+    }
+
+    // Build the tree in linear time: every time up to n holds a mark
+    memset(mrc->tree, 0, (size + 1) * sizeof(int));
+    for (long t = 1; t <= size; t++) {
+        if (t <= n) {
+            mrc->tree[t]++;
+        }
+        long parent = t + (t & -t);
+        if (parent <= size) {
+            mrc->tree[parent] += mrc->tree[t];
+        }
+    }
+    mrc->now = n + 1;
+}
+
+// Evict the sampled pages with the largest hash and lower the threshold to that hash
+static void mrc_shrink_sample(Mrc *mrc) {
+    uint64_t top = sample_hash(mrc->heap[0]);
+    while (mrc->pages > 0 && sample_hash(mrc->heap[0]) >= top) {
+        uint64_t key = heap_pop(mrc, mrc->pages);
+        long i = mrc_slot(mrc, key);
+        tree_add(mrc, mrc->last[i], -1);
+        mrc_remove(mrc, i);
+        mrc->pages--;
+    }
+
+    // The pages left stand for a larger share of all pages from now on
+    mrc->weight *= (double)mrc->threshold / (double)top;
+    mrc->threshold = top;
+}
+
+// Set up an empty curve for memory sizes of 1 to max_frames frames, sampling at most budget pages (0 for all)
+void mrc_init(Mrc *mrc, int max_frames, long budget) {
+    mrc->max_frames = max_frames;
+    mrc->hist = calloc(max_frames + 2, sizeof(double));
+    if (mrc->hist == NULL) {
+        fatal("Cannot allocate the miss-ratio curve histogram");
+    }
+    mrc->cold = 0;
+    mrc->refs = 0;
+    mrc->budget = budget;
+    mrc->threshold = 1ull << MRC_HASH_BITS;  // start with every page, the budget lowers the rate as needed
+    mrc->weight = 1;
+    mrc->sampled = 0;
+    mrc->heap = NULL;
+    if (budget > 0) {
+        mrc->heap = malloc((budget + 1) * sizeof(uint64_t));
+        if (mrc->heap == NULL) {
+            fatal("Cannot allocate the page sample");
+        }
+    }
+    mrc->cap = 1024;
+    mrc->pages = 0;
+    mrc->keys = malloc(mrc->cap * sizeof(uint64_t));
+    mrc->last = malloc(mrc->cap * sizeof(long));
+    mrc->size = 1024;
+    mrc->tree = calloc(mrc->size + 1, sizeof(int));
+    mrc->key_at = malloc((mrc->size + 1) * sizeof(uint64_t));
+    mrc->now = 1;
+    if (mrc->hist == NULL || mrc->keys == NULL || mrc->last == NULL || mrc->tree == NULL || mrc->key_at == NULL) {
+        fatal("Cannot allocate the stack distance analysis");
+    }
+    memset(mrc->keys, 0xff, mrc->cap * sizeof(uint64_t));
+}
+
+// Record a reference to a page, key identifies the page (process and page number)
+void mrc_access(Mrc *mrc, uint64_t key) {
+    mrc->refs++;
+    if (mrc->budget > 0 && sample_hash(key) >= mrc->threshold) {
+        return;
+    }
+    mrc->sampled++;
+    if (mrc->now > mrc->size) {
+        mrc_renumber(mrc);
+    }
+
+    long i = mrc_slot(mrc, key);
+    if (mrc->keys[i] == key) {
+        // Distinct pages referenced since the last reference to this one, plus itself, scaled from the sample
+        long t = mrc->last[i];
+        double distance = (double)(mrc->pages - tree_sum(mrc, t) + 1) * mrc->weight;
+        long d = (long)(distance + 0.5);
+        mrc->hist[d <= mrc->max_frames ? d : mrc->max_frames + 1] += mrc->weight;
+        tree_add(mrc, t, -1);
+    } else {
+        mrc->cold += mrc->weight;
+        if (2 * (mrc->pages + 1) > mrc->cap) {
+            mrc_grow_table(mrc);
+            i = mrc_slot(mrc, key);
+        }
+        mrc->keys[i] = key;
+        mrc->pages++;
+        if (mrc->budget > 0) {
+            heap_push(mrc, key);
+        }
+    }
+
+    mrc->last[i] = mrc->now;
+    mrc->key_at[mrc->now] = key;
+    tree_add(mrc, mrc->now, 1);
+    mrc->now++;
+
+    if (mrc->budget > 0 && mrc->pages > mrc->budget) {
+        mrc_shrink_sample(mrc);
+    }
+}
+
+// Fill faults[f] with the page faults LRU takes with f frames, for f = 1 to max_frames
+void mrc_curve(const Mrc *mrc, long *faults) {
+    // A reference hits if its stack distance fits in the frames, so each frame removed adds the references at
+    // that distance. A sample estimates the faults of all references, so its curve is relative to the references
+    // analyzed rather than the weight of the sampled ones (SHARDS_adj). A sample holding a busier share of the pages
+    // than average can then overshoot where its distances are too coarse, so no memory size faults more than every
+    // reference.
+    double sum = mrc->cold + mrc->hist[mrc->max_frames + 1];
+    for (int f = mrc->max_frames; f >= 1; f--) {
+        faults[f] = (sum < mrc->refs) ? (long)(sum + 0.5) : mrc->refs;
+        sum += mrc->hist[f];
+    }
+}
+
+// Bytes used by the analysis
+size_t mrc_bytes(const Mrc *mrc) {
+    return (mrc->max_frames + 2) * sizeof(double) + mrc->cap * (sizeof(uint64_t) + sizeof(long)) +
+           (mrc->size + 1) * (sizeof(int) + sizeof(uint64_t)) +
+           (mrc->budget > 0 ? mrc->budget + 1 : 0) * sizeof(uint64_t);
+}
+
+// Free the curve
+void mrc_free(Mrc *mrc) {
+    free(mrc->hist);
+    free(mrc->keys);
+    free(mrc->last);
+    free(mrc->tree);
+    free(mrc->key_at);
+    free(mrc->heap);
+}
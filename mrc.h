@@ -0,0 +1,56 @@
+#ifndef MRC_H
+#define MRC_H
+
+#include <stdint.h>
+
+// Analysis modes, selected with -M
+#define MRC_EXACT 0 // stack distance of every reference
+#define MRC_SHARDS 1 // stack distances of a spatial sample of the pages, within a fixed number of pages
+#define MRC_BOTH 2 // both, to report the error of the sample against the exact curve
+
+#define MRC_DEFAULT_BUDGET 8192 // pages a sample holds if -M does not say
+#define MRC_HASH_BITS 24 // a page is sampled if the low bits of its hash are below the threshold
+
+// Structs
+
+// LRU miss-ratio curve from stack distances (Mattson). Every page keeps a mark at the time of its last reference in a
+// Fenwick tree, so the distinct pages referenced since then are a prefix sum away. Times are renumbered when the
+// tree fills up, which keeps memory proportional to the number of distinct pages.
+// With a budget the analysis only follows the pages whose hash is below a threshold (SHARDS). Their distances are
+// scaled up by the sampling rate and each of their references stands for 1 / rate references. Whenever the sample
+// outgrows the budget the threshold drops to evict the pages with the largest hashes, so memory stays constant.
+typedef struct {
+    int max_frames; // largest memory size of the curve in frames
+    double *hist; // hist[d] counts references at stack distance d, hist[max_frames + 1] those beyond max_frames
+    double cold; // first references to a page
+    long refs; // references analyzed
+    long budget; // largest number of sampled pages, 0 to analyze every page
+    uint64_t threshold; // pages whose hash is below it are sampled, 1 << MRC_HASH_BITS samples every page
+    double weight; // references each sampled reference stands for, 1 / rate
+    long sampled; // references to sampled pages
+    uint64_t *heap; // max-heap of the sampled pages by hash, the next to evict on top
+    uint64_t *keys; // hash table of the pages seen, open addressing, MRC_EMPTY marks a free entry
+    long *last; // time of the last reference to the page in the same entry of keys
+    long cap; // entries of the hash table, a power of two
+    long pages; // pages in the hash table
+    int *tree; // Fenwick tree over times 1..size, 1 at the last reference of each page
+    uint64_t *key_at; // page referenced at each time
+    long size; // times the tree can hold before it is renumbered
+    long now; // next time
+} Mrc;
+
+
+// Function prototypes
+
+// Set up an empty curve for memory sizes of 1 to max_frames frames, sampling at most budget pages (0 for all)
+void mrc_init(Mrc *mrc, int max_frames, long budget);
+// Record a reference to a page, key identifies the page (process and page number)
+void mrc_access(Mrc *mrc, uint64_t key);
+// Fill faults[f] with the page faults LRU takes with f frames, for f = 1 to max_frames
+void mrc_curve(const Mrc *mrc, long *faults);
+// Bytes used by the analysis
+size_t mrc_bytes(const Mrc *mrc);
+// Free the curve
+void mrc_free(Mrc *mrc);
+
+#endif
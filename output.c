@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "output.h"
+
+// Two hex digits for every byte value
+static char hex_pairs[256][2];
+
+// Fill the hex digit table
+static void init_hex_pairs(void) {
+    const char *digits = "0123456789abcdef";
+    for (int i = 0; i < 256; i++) {
+        hex_pairs[i][0] = digits[i >> 4];
+        hex_pairs[i][1] = digits[i & 0xf];
+    }
+}
+
+// Write v in hex with at least min_digits digits, returns the position after the last digit
+static char *put_hex(char *p, uint64_t v, int min_digits) {
+    int digits = (64 - __builtin_clzll(v | 1) + 3) / 4;
+    if (digits < min_digits) {
+        digits = min_digits;
+    }
+    char *end = p + digits;
+    char *q = end;
+    // Two digits per table lookup, from the least significant end
+    while (q - p >= 2) {
+        q -= 2;
+        memcpy(q, hex_pairs[v & 0xff], 2);
+        v >>= 8;
+    }
+    if (q > p) {
+        *p = hex_pairs[v & 0xf][1];
+    }
+    return end;
+}
+
+// Append a string literal
+static char *put_str(char *p, const char *s, size_t len) {
+    memcpy(p, s, len);
+    return p + len;
+}
+
+#define PUT_STR(p, s) put_str(p, s, sizeof(s) - 1)
+
+// Write a little-endian 32 bit field
+static void put_le32(char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (char)(v >> (8 * i));
+    }
+}
+
+// Write the buffered bytes to the output file
+static void writer_flush(Writer *w) {
+    size_t done = 0;
+    while (done < w->len) {
+        ssize_t n = write(w->fd, w->buf + done, w->len - done);
+        if (n < 0) {
+            fatal("Cannot write the output file");
+        }
+        done += n;
+    }
+    w->len = 0;
+}
+
+// Create the output file and allocate the output buffer
+void writer_open(Writer *w, const char *outfile, int mode) {
+    w->fd = open(outfile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) {
+        fatal("Cannot create the output file %s", outfile);
+    }
+    w->mode = mode;
+    w->buf = malloc(OUT_BUF_SIZE);
+    if (w->buf == NULL) {
+        fatal("Cannot allocate the output buffer");
+    }
+    w->len = 0;
+    w->ref_count = 0;
+    init_hex_pairs();
+
+    if (mode == OUT_BINARY) {
+        // Reserve the header, it is filled in by writer_close()
+        memset(w->buf, 0, MRES_HEADER_SIZE);
+        w->len = MRES_HEADER_SIZE;
+    }
+}
+
+// Longest text record: 7 fields of up to 16 hex digits plus labels
+#define OUT_MAX_RECORD 192
+
+// Record the translation of one memory reference
+void writer_ref(Writer *w, uint64_t addr, uint64_t pte1, uint64_t pte2, int offset, int pfn, uint64_t pa, int fault) {
+    w->ref_count++;
+    if (w->mode == OUT_SUMMARY) {
+        return;
+    }
+    if (w->len + OUT_MAX_RECORD > OUT_BUF_SIZE) {
+        writer_flush(w);
+    }
+
+    char *p = w->buf + w->len;
+    if (w->mode == OUT_BINARY) {
+        put_le32(p, (uint32_t)pfn | (fault ? MRES_FAULT_FLAG : 0));
+        put_le32(p + 4, (uint32_t)pa);
+        put_le32(p + 8, (uint32_t)(pa >> 32));
+        w->len += MRES_RECORD_SIZE;
+        return;
+    }
+
+    // ADDR:0x%04x PTE1:0x%x PTE2:0x%x offset:0x%x PFN:0x%x PA:0x%04x followed by pgfault or a blank
+    p = PUT_STR(p, "ADDR:0x");
+    p = put_hex(p, addr, 4);
+    p = PUT_STR(p, " PTE1:0x");
+    p = put_hex(p, pte1, 1);
+    p = PUT_STR(p, " PTE2:0x");
+    p = put_hex(p, pte2, 1);
+    p = PUT_STR(p, " offset:0x");
+    p = put_hex(p, offset, 1);
+    p = PUT_STR(p, " PFN:0x");
+    p = put_hex(p, pfn, 1);
+    p = PUT_STR(p, " PA:0x");
+    p = put_hex(p, pa, 4);
+    if (fault) {
+        p = PUT_STR(p, " pgfault\n");
+    } else {
+        p = PUT_STR(p, "  \n");
+    }
+    w->len = p - w->buf;
+}
+
+// Write the page fault count, flush the buffer and close the output file
+void writer_close(Writer *w, long pfault_count) {
+    if (w->mode == OUT_BINARY) {
+        writer_flush(w);
+        char header[MRES_HEADER_SIZE];
+        memcpy(header, MRES_MAGIC, 4);
+        header[4] = MRES_VERSION;
+        header[5] = 0;
+        header[6] = MRES_RECORD_SIZE;
+        header[7] = 0;
+        put_le32(header + 8, (uint32_t)w->ref_count);
+        put_le32(header + 12, (uint32_t)(w->ref_count >> 32));
+        put_le32(header + 16, (uint32_t)pfault_count);
+        put_le32(header + 20, (uint32_t)((uint64_t)pfault_count >> 32));
+        if (pwrite(w->fd, header, sizeof(header), 0) != sizeof(header)) {
+            fatal("Cannot write the output file");
+        }
+    } else {
+        if (w->len + OUT_MAX_RECORD > OUT_BUF_SIZE) {
+            writer_flush(w);
+        }
+        w->len += sprintf(w->buf + w->len, "%ld\n", pfault_count);
+        writer_flush(w);
+    }
+    close(w->fd);
+    free(w->buf);
+    w->buf = NULL;
+}
+
+// Parse the name of an output mode, returns -1 if unknown
+int output_mode(const char *name) {
+    if (strcmp(name, "text") == 0) {
+        return OUT_TEXT;
+    } else if (strcmp(name, "binary") == 0) {
+        return OUT_BINARY;
+    } else if (strcmp(name, "summary") == 0) {
+        return OUT_SUMMARY;
+    }
+    return -1;
+}
@@ -0,0 +1,47 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Output modes, selected with -m
+#define OUT_TEXT 0 // one text line per reference, then the page fault count (default)
+#define OUT_BINARY 1 // packed binary records, see below
+#define OUT_SUMMARY 2 // only the page fault count
+
+// Size of the output buffer, it is flushed with a single write when full
+#define OUT_BUF_SIZE (1 << 20)
+
+// Binary result layout, all fields little-endian:
+//   header:  "MRES" | version u16 | record size u16 | ref count u64 | page fault count u64
+//   records: pfn u32 with the page fault flag in bit 31 | pa u64
+#define MRES_MAGIC "MRES"
+#define MRES_VERSION 2
+#define MRES_HEADER_SIZE 24
+#define MRES_RECORD_SIZE 12
+#define MRES_FAULT_FLAG 0x80000000u
+
+// Structs
+
+// Buffered writer for the simulation results
+typedef struct {
+    int fd; // output file descriptor
+    int mode; // OUT_TEXT, OUT_BINARY or OUT_SUMMARY
+    char *buf; // output buffer
+    size_t len; // bytes waiting in the buffer
+    uint64_t ref_count; // number of records written
+} Writer;
+
+
+// Function prototypes
+
+// Create the output file and allocate the output buffer
+void writer_open(Writer *w, const char *outfile, int mode);
+// Record the translation of one memory reference
+void writer_ref(Writer *w, uint64_t addr, uint64_t pte1, uint64_t pte2, int offset, int pfn, uint64_t pa, int fault);
+// Write the page fault count, flush the buffer and close the output file
+void writer_close(Writer *w, long pfault_count);
+// Parse the name of an output mode, returns -1 if unknown
+int output_mode(const char *name);
+
+#endif
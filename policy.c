@@ -0,0 +1,1097 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "ghost.h"
+#include "log.h"
+#include "policy.h"
+
+// FIFO and LRU
+
+// Resident frames from the oldest (head) to the newest (tail), linked through the frame table.
+// FIFO orders them by load time, LRU also moves a frame to the tail when it is referenced.
+typedef struct {
+    FrameList order;
+} ListState;
+
+static void list_init(Policy *p) {
+    ListState *st = malloc(sizeof(ListState));
+    if (st == NULL) {
+        fatal("Cannot allocate the frame list");
+    }
+    st->order.head = -1;
+    st->order.tail = -1;
+    p->state = st;
+}
+
+static void fifo_on_hit(Policy *p, int frame) {
+    (void)p;
+    (void)frame;
+}
+
+static void lru_on_hit(Policy *p, int frame) {
+    ListState *st = p->state;
+    frame_list_unlink(p->ft, &st->order, frame);
+    frame_list_push_back(p->ft, &st->order, frame);
+}
+
+static void list_on_fault_insert(Policy *p, int frame) {
+    ListState *st = p->state;
+    frame_list_push_back(p->ft, &st->order, frame);
+
+    // print the replacement order
+    if (LOG_ENABLED(LOG_LEVEL_TRACE)) {
+        int i = 0;
+        for (int f = st->order.head; f >= 0; f = p->ft->entries[f].next) {
+            LOG_TRACE("order[%d]: frame %d", i++, f);
+        }
+    }
+}
+
+static int list_select_victim(Policy *p, int proc, long vpn) {
+    (void)proc;
+    (void)vpn;
+    ListState *st = p->state;
+    return frame_list_pop_front(p->ft, &st->order);
+}
+
+static void list_destroy(Policy *p) {
+    free(p->state);
+}
+
+// CLOCK and ECLOCK
+
+// The hand sweeps the policy's frames in frame order and wraps around. The policy's frames are a bitmap, so a sweep
+// skips the frames of other policies and tests the R and M bits of 64 frames at once. A loaded page takes the frame
+// of its victim, just behind the hand, so with every frame in one policy the hand sweeps the whole frame table.
+typedef struct {
+    int hand; // frame the hand points to
+    int count; // frames the policy manages
+    uint64_t *own; // bitmap of the frames the policy manages
+} ClockState;
+
+static void clock_init(Policy *p) {
+    ClockState *st = malloc(sizeof(ClockState));
+    if (st == NULL) {
+        fatal("Cannot allocate the clock");
+    }
+    st->hand = 0;
+    st->count = 0;
+    st->own = calloc(p->ft->words, sizeof(uint64_t));
+    if (st->own == NULL) {
+        fatal("Cannot allocate the clock");
+    }
+    p->state = st;
+}
+
+static void clock_on_hit(Policy *p, int frame) {
+    (void)p;
+    (void)frame;
+}
+
+static void clock_on_fault_insert(Policy *p, int frame) {
+    ClockState *st = p->state;
+    bitmap_set(st->own, frame);
+    st->count++;
+}
+
+// Stop managing a frame, a hand pointing to it moves on to the next frame
+static void clock_remove(Policy *p, int frame) {
+    ClockState *st = p->state;
+    bitmap_clear(st->own, frame);
+    st->count--;
+    if (st->hand == frame) {
+        st->hand = (frame + 1 < p->ft->size) ? frame + 1 : 0;
+    }
+}
+
+// Sweep the policy's frames once from the hand for the first one with R clear and M equal to m (any M if m < 0),
+// clearing the R bits passed if asked. Returns the frame and leaves the hand on it, -1 after a full circle.
+static int clock_sweep(Policy *p, int m, int clear_r) {
+    ClockState *st = p->state;
+    FrameTable *ft = p->ft;
+    int w = st->hand >> 6;
+    uint64_t first = ~0ull << (st->hand & 63);  // the frames at or after the hand in its word
+    for (int i = 0; i <= ft->words; i++) {
+        // The circle ends back in the hand's word, with the frames before the hand
+        uint64_t own = st->own[w] & ((i == 0) ? first : (i == ft->words) ? ~first : ~0ull);
+        uint64_t want = own & ~ft->r[w] & ((m < 0) ? ~0ull : (m == 1) ? ft->m[w] : ~ft->m[w]);
+        if (want != 0) {
+            uint64_t passed = own & ((want & -want) - 1);
+            if (clear_r) {
+                ft->r[w] &= ~passed;
+            }
+            p->travel += __builtin_popcountll(passed) + 1;
+            st->hand = (w << 6) + __builtin_ctzll(want);
+            return st->hand;
+        }
+        if (clear_r) {
+            ft->r[w] &= ~own;
+        }
+        p->travel += __builtin_popcountll(own);
+        w = (w + 1 < ft->words) ? w + 1 : 0;
+    }
+    return -1;
+}
+
+static int clock_select_victim(Policy *p, int proc, long vpn) {
+    (void)proc;
+    (void)vpn;
+    // Give referenced pages a second chance, if all of them were referenced the hand comes back to the first
+    int victim = clock_sweep(p, -1, 1);
+    if (victim < 0) {
+        victim = clock_sweep(p, -1, 0);
+    }
+    clock_remove(p, victim);
+    return victim;
+}
+
+static int eclock_select_victim(Policy *p, int proc, long vpn) {
+    (void)proc;
+    (void)vpn;
+    // Step 1: (R=0, M=0) without touching the R bits
+    // Step 2: (R=0, M=1), clearing the R bits on the way
+    // Steps 3 and 4: repeat, now that every R bit is clear one of them succeeds
+    int victim = -1;
+    for (int step = 0; step < 4 && victim < 0; step++) {
+        victim = clock_sweep(p, step % 2, step % 2);
+        if (victim >= 0) {
+            LOG_TRACE("eclock step %d: victim frame %d", step + 1, victim);
+        }
+    }
+    clock_remove(p, victim);
+    return victim;
+}
+
+static void clock_destroy(Policy *p) {
+    ClockState *st = p->state;
+    free(st->own);
+    free(st);
+}
+
+// AGING and NFU
+
+// Each frame has a counter in one array, so a tick updates them in a single pass over the frames and the R bitmap.
+// AGING shifts the R bit of the tick into the top of a 32 tick history, NFU adds it to a saturating count of
+// referenced ticks. The victim is the frame with the smallest key, its R bit above its counter so that a frame
+// referenced in the current tick counts as the largest, and ties go to the lowest frame. The tick pass also sets a
+// lower bound of the smallest key of every word of 64 frames, and the words form a binary min-heap on their bounds.
+// An eviction only scans the 64 frames of the top word. If hits raised its minimum since the bound was set, the word
+// moves down with its true minimum and the next one is tried. A fault thus costs O(log fcount), not a pass over all
+// frames. Readahead clears the R bits of a batch of prefetched pages once the batch is in, so a prefetched page that
+// was not used yet counts without its R bit in a bound. While a batch is running that bound can be too low to move
+// the word down, and the word then moves down with its current minimum for this eviction only.
+typedef struct {
+    uint32_t *count; // counter of each frame
+    uint64_t *own; // bitmap of the frames the policy manages
+    uint64_t *bound; // lower bound of the smallest key of each word of frames, UINT64_MAX if it has none
+    int *heap; // words, the one with the smallest bound (the lowest of them on ties) on top
+    int *pos; // position of each word in the heap
+    int *held; // words moved down for the current eviction only
+    uint64_t *held_bound; // their bounds to restore
+} CountState;
+
+static void count_init(Policy *p) {
+    int words = p->ft->words;
+    CountState *st = malloc(sizeof(CountState));
+    if (st == NULL) {
+        fatal("Cannot allocate the reference counters");
+    }
+    st->count = calloc((size_t)words * 64, sizeof(uint32_t));  // whole words, the tick pass has no tail
+    st->own = calloc(words, sizeof(uint64_t));
+    st->bound = malloc(words * sizeof(uint64_t));
+    st->heap = malloc(words * sizeof(int));
+    st->pos = malloc(words * sizeof(int));
+    st->held = malloc(words * sizeof(int));
+    st->held_bound = malloc(words * sizeof(uint64_t));
+    if (st->count == NULL || st->own == NULL || st->bound == NULL || st->heap == NULL || st->pos == NULL ||
+        st->held == NULL || st->held_bound == NULL) {
+        fatal("Cannot allocate the reference counters");
+    }
+    for (int w = 0; w < words; w++) {
+        st->bound[w] = UINT64_MAX;
+        st->heap[w] = w;
+        st->pos[w] = w;
+    }
+    p->state = st;
+}
+
+// 1 if word a goes before word b in the heap, by bound and then by position so that ties go to the lowest frame
+static int count_before(const CountState *st, int a, int b) {
+    return st->bound[a] < st->bound[b] || (st->bound[a] == st->bound[b] && a < b);
+}
+
+// Put a word at position i of the heap
+static void count_place(CountState *st, int i, int w) {
+    st->heap[i] = w;
+    st->pos[w] = i;
+}
+
+// Move the word at position i up while it goes before its parent
+static void count_sift_up(Policy *p, int i) {
+    CountState *st = p->state;
+    int w = st->heap[i];
+    while (i > 0 && count_before(st, w, st->heap[(i - 1) / 2])) {
+        count_place(st, i, st->heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    count_place(st, i, w);
+}
+
+// Move the word at position i down while a child goes before it
+static void count_sift_down(Policy *p, int i) {
+    CountState *st = p->state;
+    int words = p->ft->words;
+    int w = st->heap[i];
+    while (2 * i + 1 < words) {
+        int child = 2 * i + 1;
+        if (child + 1 < words && count_before(st, st->heap[child + 1], st->heap[child])) {
+            child++;
+        }
+        if (!count_before(st, st->heap[child], w)) {
+            break;
+        }
+        count_place(st, i, st->heap[child]);
+        i = child;
+    }
+    count_place(st, i, w);
+}
+
+// Set the bound of every word to the smallest counter of its frames and rebuild the heap. The tick's R bits are
+// cleared right after it, so the counters are the keys.
+static void count_rebuild(Policy *p) {
+    CountState *st = p->state;
+    for (int w = 0; w < p->ft->words; w++) {
+        uint64_t best = UINT64_MAX;
+        for (uint64_t own = st->own[w]; own != 0; own &= own - 1) {
+            uint32_t c = st->count[(w << 6) + __builtin_ctzll(own)];
+            best = (c < best) ? c : best;
+        }
+        st->bound[w] = best;
+    }
+    for (int i = p->ft->words / 2 - 1; i >= 0; i--) {
+        count_sift_down(p, i);
+    }
+}
+
+static void count_on_hit(Policy *p, int frame) {
+    (void)p;
+    (void)frame;
+}
+
+static void count_on_fault_insert(Policy *p, int frame) {
+    CountState *st = p->state;
+    st->count[frame] = 0;
+    bitmap_set(st->own, frame);
+    // The page can lose its R bit before the next tick (a prefetched page does), so its key may drop to 0
+    int w = frame >> 6;
+    st->bound[w] = 0;
+    count_sift_up(p, st->pos[w]);
+}
+
+static void aging_on_tick(Policy *p) {
+    CountState *st = p->state;
+    const uint64_t *r = p->ft->r;
+    for (int w = 0; w < p->ft->words; w++) {
+        uint32_t *count = st->count + ((size_t)w << 6);
+        for (int b = 0; b < 64; b++) {
+            count[b] = (count[b] >> 1) | ((uint32_t)(r[w] >> b) << 31);
+        }
+    }
+    count_rebuild(p);
+}
+
+static void nfu_on_tick(Policy *p) {
+    CountState *st = p->state;
+    const uint64_t *r = p->ft->r;
+    for (int w = 0; w < p->ft->words; w++) {
+        uint32_t *count = st->count + ((size_t)w << 6);
+        for (int b = 0; b < 64; b++) {
+            uint32_t c = count[b] + (uint32_t)((r[w] >> b) & 1);
+            count[b] = (c != 0) ? c : UINT32_MAX;
+        }
+    }
+    count_rebuild(p);
+}
+
+static int count_select_victim(Policy *p, int proc, long vpn) {
+    (void)proc;
+    (void)vpn;
+    CountState *st = p->state;
+    int held = 0;
+    for (;;) {
+        // The smallest key of the top word is the smallest of all if it still equals the word's bound
+        int w = st->heap[0];
+        int victim = -1;
+        uint64_t best = UINT64_MAX;
+        uint64_t lower = UINT64_MAX;  // the smallest key once the pages prefetched but not used lose their R bits
+        for (uint64_t own = st->own[w]; own != 0; own &= own - 1) {
+            int f = (w << 6) + __builtin_ctzll(own);
+            uint64_t key = ((uint64_t)frame_r(p->ft, f) << 32) | st->count[f];
+            uint64_t low = (p->ft->entries[f].ra != 0) ? st->count[f] : key;
+            if (key < best) {
+                best = key;
+                victim = f;
+            }
+            lower = (low < lower) ? low : lower;
+        }
+        if (best <= st->bound[w]) {
+            // The bound stays a lower bound of the frames left in the word, and the held words get theirs back
+            bitmap_clear(st->own, victim);
+            while (held > 0) {
+                held--;
+                st->bound[st->held[held]] = st->held_bound[held];
+                count_sift_up(p, st->pos[st->held[held]]);
+            }
+            return victim;
+        }
+        if (lower <= st->bound[w]) {
+            st->held[held] = w;
+            st->held_bound[held++] = lower;
+        }
+        st->bound[w] = (lower > st->bound[w]) ? lower : best;
+        count_sift_down(p, 0);
+    }
+}
+
+static void count_destroy(Policy *p) {
+    CountState *st = p->state;
+    free(st->count);
+    free(st->own);
+    free(st->bound);
+    free(st->heap);
+    free(st->pos);
+    free(st->held);
+    free(st->held_bound);
+    free(st);
+}
+
+// WSCLOCK
+
+// CLOCK over the working set: the hand stamps referenced frames with the current tick, and a page not referenced
+// within the window has left the working set. The first clean page out of the working set is the victim. A dirty
+// one would have to be written first, so it is only taken if a whole sweep finds no clean one. If every page is in
+// the working set the oldest clean page goes, or the oldest page if all are dirty.
+typedef struct {
+    ClockState clock; // the policy's frames and the hand
+    unsigned int *last_use; // tick of the last reference seen to each frame
+    unsigned int now; // ticks so far
+} WsState;
+
+static void ws_init(Policy *p) {
+    clock_init(p);
+    WsState *st = malloc(sizeof(WsState));
+    if (st == NULL) {
+        fatal("Cannot allocate the working-set clock");
+    }
+    st->clock = *(ClockState *)p->state;
+    free(p->state);
+    st->last_use = calloc((size_t)p->ft->words * 64, sizeof(unsigned int));
+    if (st->last_use == NULL) {
+        fatal("Cannot allocate the working-set clock");
+    }
+    st->now = 0;
+    p->state = st;
+}
+
+static void ws_on_fault_insert(Policy *p, int frame) {
+    WsState *st = p->state;
+    clock_on_fault_insert(p, frame);
+    st->last_use[frame] = st->now;
+}
+
+static void ws_on_tick(Policy *p) {
+    WsState *st = p->state;
+    const uint64_t *r = p->ft->r;
+    unsigned int now = ++st->now;
+    for (int w = 0; w < p->ft->words; w++) {
+        unsigned int *last_use = st->last_use + ((size_t)w << 6);
+        for (int b = 0; b < 64; b++) {
+            last_use[b] = ((r[w] >> b) & 1) ? now : last_use[b];
+        }
+    }
+}
+
+static int ws_select_victim(Policy *p, int proc, long vpn) {
+    (void)proc;
+    (void)vpn;
+    WsState *st = p->state;
+    FrameTable *ft = p->ft;
+    int victim = -1;  // first clean page out of the working set
+    int old_dirty = -1;  // first dirty page out of the working set
+    int oldest_clean = -1;
+    int oldest = -1;
+    int f = st->clock.hand;
+    int examined;  // frames the hand examined
+    for (examined = 0; examined < st->clock.count; examined++) {
+        f = bitmap_next(ft, st->clock.own, f);
+        if (frame_r(ft, f)) {
+            frame_clear_r(ft, f);
+            st->last_use[f] = st->now;
+        } else if (st->now - st->last_use[f] > (unsigned int)p->window) {
+            if (!frame_m(ft, f)) {
+                victim = f;
+                examined++;
+                break;
+            }
+            if (old_dirty < 0) {
+                old_dirty = f;
+            }
+        }
+        if (oldest < 0 || st->last_use[f] < st->last_use[oldest]) {
+            oldest = f;
+        }
+        if (!frame_m(ft, f) && (oldest_clean < 0 || st->last_use[f] < st->last_use[oldest_clean])) {
+            oldest_clean = f;
+        }
+        f = (f + 1 < ft->size) ? f + 1 : 0;
+    }
+    st->clock.hand = f;
+    p->travel += examined;
+
+    if (victim < 0) {
+        victim = (old_dirty >= 0) ? old_dirty : (oldest_clean >= 0) ? oldest_clean : oldest;
+    }
+    LOG_TRACE("wsclock: victim frame %d, last used in tick %u of %u", victim, st->last_use[victim], st->now);
+    clock_remove(p, victim);
+    return victim;
+}
+
+static void ws_destroy(Policy *p) {
+    WsState *st = p->state;
+    free(st->clock.own);
+    free(st->last_use);
+    free(st);
+}
+
+
+// OPT
+
+// Belady's optimal algorithm evicts the page whose next use is furthest away. The frames form a binary max-heap on
+// their next_use, which the simulator fills in from the next-use index before every call.
+typedef struct {
+    int *heap; // frames, the one used furthest in the future on top
+    int *pos; // position of each frame in the heap, -1 if the policy does not manage it
+    int count; // frames in the heap
+} OptState;
+
+static void opt_init(Policy *p) {
+    OptState *st = malloc(sizeof(OptState));
+    if (st == NULL) {
+        fatal("Cannot allocate the OPT heap");
+    }
+    st->heap = malloc(p->ft->size * sizeof(int));
+    st->pos = malloc(p->ft->size * sizeof(int));
+    if (st->heap == NULL || st->pos == NULL) {
+        fatal("Cannot allocate the OPT heap");
+    }
+    for (int i = 0; i < p->ft->size; i++) {
+        st->pos[i] = -1;
+    }
+    st->count = 0;
+    p->state = st;
+}
+
+// Put a frame at position i of the heap
+static void opt_place(Policy *p, int i, int frame) {
+    OptState *st = p->state;
+    st->heap[i] = frame;
+    st->pos[frame] = i;
+}
+
+// Move the frame at position i up while its next use is further away than its parent's
+static void opt_sift_up(Policy *p, int i) {
+    OptState *st = p->state;
+    int frame = st->heap[i];
+    long key = p->ft->entries[frame].next_use;
+    while (i > 0 && p->ft->entries[st->heap[(i - 1) / 2]].next_use < key) {
+        opt_place(p, i, st->heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    opt_place(p, i, frame);
+}
+
+// Move the frame at position i down while a child's next use is further away
+static void opt_sift_down(Policy *p, int i) {
+    OptState *st = p->state;
+    FrameInfo *e = p->ft->entries;
+    int frame = st->heap[i];
+    long key = e[frame].next_use;
+    while (2 * i + 1 < st->count) {
+        int child = 2 * i + 1;
+        if (child + 1 < st->count && e[st->heap[child + 1]].next_use > e[st->heap[child]].next_use) {
+            child++;
+        }
+        if (e[st->heap[child]].next_use <= key) {
+            break;
+        }
+        opt_place(p, i, st->heap[child]);
+        i = child;
+    }
+    opt_place(p, i, frame);
+}
+
+static void opt_on_hit(Policy *p, int frame) {
+    // The page's next use only moves later
+    OptState *st = p->state;
+    opt_sift_up(p, st->pos[frame]);
+}
+
+static void opt_on_fault_insert(Policy *p, int frame) {
+    OptState *st = p->state;
+    opt_place(p, st->count++, frame);
+    opt_sift_up(p, st->count - 1);
+}
+
+static int opt_select_victim(Policy *p, int proc, long vpn) {
+    (void)proc;
+    (void)vpn;
+    OptState *st = p->state;
+    int victim = st->heap[0];
+    st->pos[victim] = -1;
+    if (--st->count > 0) {
+        opt_place(p, 0, st->heap[st->count]);
+        opt_sift_down(p, 0);
+    }
+    LOG_TRACE("opt: victim frame %d, next used at reference %ld", victim, p->ft->entries[victim].next_use);
+    return victim;
+}
+
+static void opt_destroy(Policy *p) {
+    OptState *st = p->state;
+    free(st->heap);
+    free(st->pos);
+    free(st);
+}
+
+// Adaptive policies with ghosts: ARC, CAR and CLOCK-Pro
+
+// No page key has every bit set
+#define NO_PAGE UINT64_MAX
+
+// Key of a page in the ghost directory, the process goes above the page number, which has at most 42 bits
+static uint64_t page_key(int proc, long vpn) {
+    return ((uint64_t)proc << 48) | (uint64_t)vpn;
+}
+
+// Key of the page in a frame
+static uint64_t frame_key(const FrameTable *ft, int frame) {
+    return page_key(ft->entries[frame].proc, ft->entries[frame].vpn);
+}
+
+// ARC (and CAR below): T1 holds the pages referenced once recently and T2 those referenced again, both in LRU order.
+// The ghosts of their evicted pages (B1 and B2) steer the target size p of T1: a fault on a B1 ghost means T1 was too
+// small, one on a B2 ghost that T2 was.
+typedef struct {
+    FrameList t1; // resident pages seen once, LRU first
+    FrameList t2; // resident pages seen at least twice, LRU first
+    int t1_count;
+    int t2_count;
+    unsigned char *in_t2; // 1 for the frames in T2
+    unsigned char *ref; // reference bit of each frame, set by hits (CAR)
+    Ghosts ghosts; // pages evicted from T1 (B1) and T2 (B2)
+    GhostList b1;
+    GhostList b2;
+    int c; // frames of the cache
+    int p; // target size of T1
+    uint64_t adapted; // faulting page whose ghost already adapted p while its frame was freed, NO_PAGE if none
+} ArcState;
+
+static void arc_init(Policy *p) {
+    ArcState *st = malloc(sizeof(ArcState));
+    if (st == NULL) {
+        fatal("Cannot allocate the ARC state");
+    }
+    st->t1 = (FrameList){-1, -1};
+    st->t2 = (FrameList){-1, -1};
+    st->t1_count = 0;
+    st->t2_count = 0;
+    st->in_t2 = calloc(p->ft->size, 1);
+    st->ref = calloc(p->ft->size, 1);
+    if (st->in_t2 == NULL || st->ref == NULL) {
+        fatal("Cannot allocate the ARC state");
+    }
+    // The directory holds at most 2c pages, resident or ghost
+    ghosts_init(&st->ghosts, 2 * p->ft->size + 2);
+    st->b1 = (GhostList){-1, -1, 0};
+    st->b2 = (GhostList){-1, -1, 0};
+    st->c = p->ft->size;
+    st->p = 0;
+    st->adapted = NO_PAGE;
+    p->state = st;
+}
+
+// Move the target size of T1 toward the list whose ghost was hit
+static void arc_adapt(ArcState *st, int ghost) {
+    if (st->ghosts.owner[ghost] == &st->b1) {
+        int step = (st->b2.count > st->b1.count) ? st->b2.count / st->b1.count : 1;
+        st->p = (st->p + step < st->c) ? st->p + step : st->c;
+    } else {
+        int step = (st->b1.count > st->b2.count) ? st->b1.count / st->b2.count : 1;
+        st->p = (st->p - step > 0) ? st->p - step : 0;
+    }
+}
+
+// Evict the LRU page of T1 if T1 is over its target, of T2 otherwise, and remember it as a ghost
+static int arc_replace(Policy *p, int in_b2) {
+    ArcState *st = p->state;
+    int frame;
+    if (st->t2_count == 0 || (st->t1_count > 0 && (st->t1_count > st->p || (in_b2 && st->t1_count == st->p)))) {
+        frame = frame_list_pop_front(p->ft, &st->t1);
+        st->t1_count--;
+        ghost_push(&st->ghosts, &st->b1, frame_key(p->ft, frame));
+    } else {
+        frame = frame_list_pop_front(p->ft, &st->t2);
+        st->t2_count--;
+        st->in_t2[frame] = 0;
+        ghost_push(&st->ghosts, &st->b2, frame_key(p->ft, frame));
+    }
+    return frame;
+}
+
+static void arc_on_hit(Policy *p, int frame) {
+    ArcState *st = p->state;
+    if (st->in_t2[frame]) {
+        frame_list_unlink(p->ft, &st->t2, frame);
+    } else {
+        frame_list_unlink(p->ft, &st->t1, frame);
+        st->t1_count--;
+        st->t2_count++;
+        st->in_t2[frame] = 1;
+    }
+    frame_list_push_back(p->ft, &st->t2, frame);
+}
+
+static void arc_on_fault_insert(Policy *p, int frame) {
+    ArcState *st = p->state;
+    uint64_t key = frame_key(p->ft, frame);
+    int ghost = ghost_find(&st->ghosts, key);
+    if (ghost >= 0) {
+        // Seen before, straight to T2
+        if (st->adapted != key) {
+            arc_adapt(st, ghost);
+        }
+        ghost_remove(&st->ghosts, ghost);
+        frame_list_push_back(p->ft, &st->t2, frame);
+        st->t2_count++;
+        st->in_t2[frame] = 1;
+    } else {
+        frame_list_push_back(p->ft, &st->t1, frame);
+        st->t1_count++;
+    }
+    st->adapted = NO_PAGE;
+}
+
+static int arc_select_victim(Policy *p, int proc, long vpn) {
+    ArcState *st = p->state;
+    uint64_t key = page_key(proc, vpn);
+    int ghost = ghost_find(&st->ghosts, key);
+    if (ghost >= 0) {
+        arc_adapt(st, ghost);
+        st->adapted = key;
+        return arc_replace(p, st->ghosts.owner[ghost] == &st->b2);
+    }
+
+    // A new page, keep the directory within c pages for T1 and B1 and 2c pages in all
+    st->adapted = NO_PAGE;
+    if (st->t1_count + st->b1.count >= st->c) {
+        if (st->b1.count == 0 && st->t1_count > 0) {
+            // T1 fills the cache, its LRU page leaves without a ghost
+            int frame = frame_list_pop_front(p->ft, &st->t1);
+            st->t1_count--;
+            return frame;
+        }
+        if (st->b1.count > 0) {
+            ghost_drop_oldest(&st->ghosts, &st->b1);
+        }
+    } else if (st->t1_count + st->t2_count + st->b1.count + st->b2.count >= 2 * st->c && st->b2.count > 0) {
+        ghost_drop_oldest(&st->ghosts, &st->b2);
+    }
+    return arc_replace(p, 0);
+}
+
+static void arc_destroy(Policy *p) {
+    ArcState *st = p->state;
+    free(st->in_t2);
+    free(st->ref);
+    ghosts_free(&st->ghosts);
+    free(st);
+}
+
+// CAR: ARC with a CLOCK for each of T1 and T2, so a hit only sets a reference bit. The head of each list is under
+// its hand. A referenced page there gets its bit cleared and moves to the tail of T2, from T1 or from T2 itself.
+// The victim is the first unreferenced page under the hand of T1 if T1 is at or over its target, else of T2.
+static int car_replace(Policy *p) {
+    ArcState *st = p->state;
+    for (;;) {
+        int from_t1 = (st->t2_count == 0 || (st->t1_count > 0 && st->t1_count >= (st->p > 1 ? st->p : 1)));
+        FrameList *list = from_t1 ? &st->t1 : &st->t2;
+        int frame = frame_list_pop_front(p->ft, list);
+        p->travel++;
+        if (!st->ref[frame]) {
+            if (from_t1) {
+                st->t1_count--;
+                ghost_push(&st->ghosts, &st->b1, frame_key(p->ft, frame));
+            } else {
+                st->t2_count--;
+                st->in_t2[frame] = 0;
+                ghost_push(&st->ghosts, &st->b2, frame_key(p->ft, frame));
+            }
+            return frame;
+        }
+        st->ref[frame] = 0;
+        frame_list_push_back(p->ft, &st->t2, frame);
+        if (from_t1) {
+            st->t1_count--;
+            st->t2_count++;
+            st->in_t2[frame] = 1;
+        }
+    }
+}
+
+static void car_on_hit(Policy *p, int frame) {
+    ArcState *st = p->state;
+    st->ref[frame] = 1;
+}
+
+static void car_on_fault_insert(Policy *p, int frame) {
+    ArcState *st = p->state;
+    int ghost = ghost_find(&st->ghosts, frame_key(p->ft, frame));
+    st->ref[frame] = 0;
+    if (ghost >= 0) {
+        arc_adapt(st, ghost);
+        ghost_remove(&st->ghosts, ghost);
+        frame_list_push_back(p->ft, &st->t2, frame);
+        st->t2_count++;
+        st->in_t2[frame] = 1;
+    } else {
+        frame_list_push_back(p->ft, &st->t1, frame);
+        st->t1_count++;
+    }
+}
+
+static int car_select_victim(Policy *p, int proc, long vpn) {
+    ArcState *st = p->state;
+    int frame = car_replace(p);
+
+    // A new page keeps the directory within c pages for T1 and B1 and 2c pages in all
+    if (ghost_find(&st->ghosts, page_key(proc, vpn)) < 0) {
+        if (st->t1_count + st->b1.count >= st->c && st->b1.count > 0) {
+            ghost_drop_oldest(&st->ghosts, &st->b1);
+        } else if (st->t1_count + st->t2_count + st->b1.count + st->b2.count >= 2 * st->c && st->b2.count > 0) {
+            ghost_drop_oldest(&st->ghosts, &st->b2);
+        }
+    }
+    return frame;
+}
+
+// CLOCK-Pro: one clock holds the resident hot and cold pages and the non-resident cold pages still in their test
+// period (ghosts). A cold page referenced during its test period has a reuse distance shorter than the coldest hot
+// page and becomes hot. The target number of resident cold pages grows when a test page faults again and shrinks
+// when a test period runs out. Clock nodes 0 to frames - 1 are the frames, the ghost entries follow them.
+#define PRO_COLD 0
+#define PRO_HOT 1
+#define PRO_TEST 2
+
+typedef struct {
+    int frames; // frames of the frame table, the first ghost node comes next
+    int *prev; // clock links of each node
+    int *next;
+    unsigned char *kind; // PRO_COLD, PRO_HOT or PRO_TEST
+    unsigned char *ref; // reference bit of each frame, set by hits
+    int hand_hot; // demotes unreferenced hot pages and ends test periods
+    int hand_cold; // evicts unreferenced cold pages and promotes referenced ones
+    int hand_test; // ends test periods, -1 for all three hands while the clock is empty
+    int hot_count; // resident hot pages
+    int cold_count; // resident cold pages
+    int cold_target; // resident cold pages to aim for, 1 to c
+    int c; // frames of the cache
+    Ghosts ghosts; // test pages
+    GhostList test;
+    uint64_t promoted; // faulting page whose test period ended while its frame was freed, NO_PAGE if none
+    long moves; // nodes the three hands examined so far
+} ProState;
+
+static void pro_init(Policy *p) {
+    ProState *st = malloc(sizeof(ProState));
+    if (st == NULL) {
+        fatal("Cannot allocate the CLOCK-Pro state");
+    }
+    int frames = p->ft->size;
+    int nodes = 2 * frames + 2;  // at most c test pages, plus one while the test hand catches up
+    st->frames = frames;
+    st->prev = malloc(nodes * sizeof(int));
+    st->next = malloc(nodes * sizeof(int));
+    st->kind = calloc(nodes, 1);
+    st->ref = calloc(frames, 1);
+    if (st->prev == NULL || st->next == NULL || st->kind == NULL || st->ref == NULL) {
+        fatal("Cannot allocate the CLOCK-Pro state");
+    }
+    st->moves = 0;
+    st->hand_hot = -1;
+    st->hand_cold = -1;
+    st->hand_test = -1;
+    st->hot_count = 0;
+    st->cold_count = 0;
+    st->cold_target = 1;
+    st->c = frames;
+    ghosts_init(&st->ghosts, nodes - frames);
+    st->test = (GhostList){-1, -1, 0};
+    st->promoted = NO_PAGE;
+    p->state = st;
+}
+
+// Insert a node into the clock just behind the hot hand, where the hand reaches it last
+static void pro_link(ProState *st, int node) {
+    if (st->hand_hot < 0) {
+        st->prev[node] = node;
+        st->next[node] = node;
+        st->hand_hot = node;
+        st->hand_cold = node;
+        st->hand_test = node;
+        return;
+    }
+    int after = st->prev[st->hand_hot];
+    st->prev[node] = after;
+    st->next[node] = st->hand_hot;
+    st->next[after] = node;
+    st->prev[st->hand_hot] = node;
+    if (st->hand_cold == st->hand_hot) {
+        st->hand_cold = node;
+    }
+}
+
+// Take a node out of the clock, a hand on it steps back so that its next move lands on the node that followed
+static void pro_unlink(ProState *st, int node) {
+    int *hands[] = {&st->hand_hot, &st->hand_cold, &st->hand_test};
+    int back = (st->prev[node] != node) ? st->prev[node] : -1;
+    for (int i = 0; i < 3; i++) {
+        if (*hands[i] == node) {
+            *hands[i] = back;
+        }
+    }
+    if (back >= 0) {
+        st->next[back] = st->next[node];
+        st->prev[st->next[node]] = back;
+    }
+}
+
+// Put a node in the place of another in the clock, hands on the old node move to the new one
+static void pro_replace_node(ProState *st, int old, int node) {
+    int *hands[] = {&st->hand_hot, &st->hand_cold, &st->hand_test};
+    for (int i = 0; i < 3; i++) {
+        if (*hands[i] == old) {
+            *hands[i] = node;
+        }
+    }
+    if (st->next[old] == old) {
+        st->prev[node] = node;
+        st->next[node] = node;
+        return;
+    }
+    st->prev[node] = st->prev[old];
+    st->next[node] = st->next[old];
+    st->next[st->prev[old]] = node;
+    st->prev[st->next[old]] = node;
+}
+
+// End the test period of a ghost, dropping it from the clock and the directory
+static void pro_drop_test(ProState *st, int ghost) {
+    pro_unlink(st, st->frames + ghost);
+    ghost_remove(&st->ghosts, ghost);
+}
+
+// Move the test hand one node, ending the test period there
+static void pro_run_test(ProState *st) {
+    if (st->hand_test == st->hand_cold && st->hand_cold >= 0) {
+        // Stay behind the cold hand, which skips its page for this round
+        st->hand_cold = st->next[st->hand_cold];
+    }
+    int node = st->hand_test;
+    st->moves++;
+    if (node >= st->frames) {
+        pro_drop_test(st, node - st->frames);
+        if (st->cold_target > 1) {
+            st->cold_target--;
+        }
+    }
+    if (st->hand_test >= 0) {
+        st->hand_test = st->next[st->hand_test];
+    }
+}
+
+// Move the hot hand one node, demoting an unreferenced hot page and ending a test period
+static void pro_run_hot(ProState *st) {
+    if (st->hand_hot == st->hand_test) {
+        pro_run_test(st);
+    }
+    int node = st->hand_hot;
+    st->moves++;
+    if (node >= st->frames) {
+        pro_drop_test(st, node - st->frames);
+        if (st->cold_target > 1) {
+            st->cold_target--;
+        }
+    } else if (st->kind[node] == PRO_HOT) {
+        if (st->ref[node]) {
+            st->ref[node] = 0;
+        } else {
+            st->kind[node] = PRO_COLD;
+            st->hot_count--;
+            st->cold_count++;
+        }
+    }
+    if (st->hand_hot >= 0) {
+        st->hand_hot = st->next[st->hand_hot];
+    }
+}
+
+// Move the cold hand one node, returns the frame it evicted or -1. A referenced cold page becomes hot, an
+// unreferenced one leaves its frame and stays in the clock as a test page.
+static int pro_run_cold(Policy *p) {
+    ProState *st = p->state;
+    int node = st->hand_cold;
+    int victim = -1;
+    st->moves++;
+    if (node < st->frames && st->kind[node] == PRO_COLD) {
+        st->cold_count--;
+        if (st->ref[node]) {
+            st->ref[node] = 0;
+            st->kind[node] = PRO_HOT;
+            st->hot_count++;
+        } else {
+            victim = node;
+            int ghost = ghost_push(&st->ghosts, &st->test, frame_key(p->ft, node));
+            st->kind[st->frames + ghost] = PRO_TEST;
+            pro_replace_node(st, node, st->frames + ghost);
+            while (st->test.count > st->c) {
+                pro_run_test(st);
+            }
+        }
+    }
+    if (st->hand_cold >= 0) {
+        st->hand_cold = st->next[st->hand_cold];
+    }
+    while (st->hot_count > st->c - st->cold_target) {
+        pro_run_hot(st);
+    }
+    return victim;
+}
+
+static void pro_on_hit(Policy *p, int frame) {
+    ProState *st = p->state;
+    st->ref[frame] = 1;
+}
+
+static void pro_on_fault_insert(Policy *p, int frame) {
+    ProState *st = p->state;
+    uint64_t key = frame_key(p->ft, frame);
+    int hot = (st->promoted == key);
+    st->promoted = NO_PAGE;
+    int ghost = ghost_find(&st->ghosts, key);
+    if (ghost >= 0) {
+        // Back within its test period before the cache was full
+        pro_drop_test(st, ghost);
+        if (st->cold_target < st->c) {
+            st->cold_target++;
+        }
+        hot = 1;
+    }
+    st->kind[frame] = hot ? PRO_HOT : PRO_COLD;
+    st->ref[frame] = 0;
+    if (hot) {
+        st->hot_count++;
+    } else {
+        st->cold_count++;
+    }
+    pro_link(st, frame);
+}
+
+static int pro_select_victim(Policy *p, int proc, long vpn) {
+    ProState *st = p->state;
+    long moves = st->moves;
+    uint64_t key = page_key(proc, vpn);
+    int ghost = ghost_find(&st->ghosts, key);
+    st->promoted = NO_PAGE;
+    if (ghost >= 0) {
+        // A test page faulting again comes back hot, and cold pages deserve more room
+        pro_drop_test(st, ghost);
+        if (st->cold_target < st->c) {
+            st->cold_target++;
+        }
+        st->promoted = key;
+    }
+
+    // Only cold pages are evicted. With local replacement a process can hold fewer than c frames, all of them hot,
+    // so the hot hand then demotes some first.
+    int victim;
+    do {
+        while (st->cold_count == 0) {
+            pro_run_hot(st);
+        }
+    } while ((victim = pro_run_cold(p)) < 0);
+    p->travel += st->moves - moves;
+    return victim;
+}
+
+static void pro_destroy(Policy *p) {
+    ProState *st = p->state;
+    free(st->prev);
+    free(st->next);
+    free(st->kind);
+    free(st->ref);
+    ghosts_free(&st->ghosts);
+    free(st);
+}
+
+
+// Available algorithms
+static const PolicyOps policies[] = {
+    {"FIFO", list_init, fifo_on_hit, list_on_fault_insert, list_select_victim, NULL, list_destroy, 0},
+    {"LRU", list_init, lru_on_hit, list_on_fault_insert, list_select_victim, NULL, list_destroy, 0},
+    {"CLOCK", clock_init, clock_on_hit, clock_on_fault_insert, clock_select_victim, NULL, clock_destroy, 0},
+    {"ECLOCK", clock_init, clock_on_hit, clock_on_fault_insert, eclock_select_victim, NULL, clock_destroy, 0},
+    {"AGING", count_init, count_on_hit, count_on_fault_insert, count_select_victim, aging_on_tick, count_destroy, 0},
+    {"NFU", count_init, count_on_hit, count_on_fault_insert, count_select_victim, nfu_on_tick, count_destroy, 0},
+    {"WSCLOCK", ws_init, clock_on_hit, ws_on_fault_insert, ws_select_victim, ws_on_tick, ws_destroy, 0},
+    {"OPT", opt_init, opt_on_hit, opt_on_fault_insert, opt_select_victim, NULL, opt_destroy, 1},
+    {"ARC", arc_init, arc_on_hit, arc_on_fault_insert, arc_select_victim, NULL, arc_destroy, 0},
+    {"CAR", arc_init, car_on_hit, car_on_fault_insert, car_select_victim, NULL, arc_destroy, 0},
+    {"CLOCKPRO", pro_init, pro_on_hit, pro_on_fault_insert, pro_select_victim, NULL, pro_destroy, 0},
+};
+
+// Find the operations of the named algorithm, NULL if there is none
+const PolicyOps *policy_lookup(const char *name) {
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        if (strcmp(policies[i].name, name) == 0) {
+            return &policies[i];
+        }
+    }
+    return NULL;
+}
+
+// Create a policy over the frames of a frame table, window is the working-set window in ticks
+Policy *policy_create(const char *name, FrameTable *ft, int window) {
+    const PolicyOps *ops = policy_lookup(name);
+    if (ops == NULL) {
+        fatal("Wrong page replacement algorithm");
+    }
+    Policy *p = malloc(sizeof(Policy));
+    if (p == NULL) {
+        fatal("Cannot allocate the %s policy", name);
+    }
+    p->ops = ops;
+    p->ft = ft;
+    p->state = NULL;
+    p->window = window;
+    p->travel = 0;
+    ops->init(p);
+    return p;
+}
+
+// Free a policy and its state
+void policy_free(Policy *p) {
+    p->ops->destroy(p);
+    free(p);
+}
@@ -0,0 +1,44 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "frame.h"
+
+// Structs
+
+typedef struct Policy Policy;
+
+// Operations of a page replacement algorithm, each algorithm implements them once.
+// Policies work on frame numbers and keep their state in the frame table.
+typedef struct {
+    const char *name; // name used with -a
+    void (*init)(Policy *p); // allocate the algorithm state
+    void (*on_hit)(Policy *p, int frame); // the page in a frame was referenced
+    void (*on_fault_insert)(Policy *p, int frame); // a page was loaded into a frame, the policy now manages it
+    int (*select_victim)(Policy *p, int proc, long vpn); // choose the frame to evict for the faulting page vpn of
+    // process proc (an index in the process table) and stop managing it
+    void (*on_tick)(Policy *p); // timer tick, before the R bits are cleared (may be NULL)
+    void (*destroy)(Policy *p); // free the algorithm state
+    int offline; // 1 if the algorithm needs the next use of every page, which takes the whole trace up front
+} PolicyOps;
+
+// Page replacement policy, bound once after the arguments are read. Several policies can share a frame table,
+// each managing the frames that were loaded through it.
+struct Policy {
+    const PolicyOps *ops; // the algorithm
+    FrameTable *ft; // frames the policy manages
+    void *state; // algorithm state
+    int window; // working-set window in ticks (WSCLOCK)
+    long travel; // frames (clock nodes) the clock hands examined while choosing victims, 0 without a hand
+};
+
+
+// Function prototypes
+
+// Find the operations of the named algorithm, NULL if there is none
+const PolicyOps *policy_lookup(const char *name);
+// Create a policy over the frames of a frame table, window is the working-set window in ticks
+Policy *policy_create(const char *name, FrameTable *ft, int window);
+// Free a policy and its state
+void policy_free(Policy *p);
+
+#endif
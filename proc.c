@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "log.h"
+#include "proc.h"
+
+// Initialize an empty process table
+void procs_init(ProcTable *procs) {
+    procs->list = NULL;
+    procs->count = 0;
+    procs->cap = 0;
+    procs->index = malloc(PROC_MAX_PID * sizeof(int));
+    if (procs->index == NULL) {
+        fatal("Cannot allocate the process table");
+    }
+    for (int i = 0; i < PROC_MAX_PID; i++) {
+        procs->index[i] = -1;
+    }
+}
+
+// Index of a process, -1 if it has not appeared yet
+int proc_find(ProcTable *procs, int pid) {
+    if (pid < 0 || pid >= PROC_MAX_PID) {
+        fatal("Process ID %d is out of range, use 0 to %d", pid, PROC_MAX_PID - 1);
+    }
+    return procs->index[pid];
+}
+
+// Add a process with an empty page table, returns its index
+int proc_add(ProcTable *procs, int pid, int levels, const int *bits, Policy *policy) {
+    if (procs->count == procs->cap) {
+        procs->cap = (procs->cap > 0) ? procs->cap * 2 : 8;
+        procs->list = realloc(procs->list, procs->cap * sizeof(Process));
+        if (procs->list == NULL) {
+            fatal("Cannot grow the process table");
+        }
+    }
+    int i = procs->count++;
+    Process *p = &procs->list[i];
+    p->pid = pid;
+    pt_init(&p->pt, levels, bits);
+    p->policy = policy;
+    p->refs = 0;
+    p->faults = 0;
+    p->rss = 0;
+    p->peak_rss = 0;
+    procs->index[pid] = i;
+    LOG_DEBUG("process %d is address space %d", pid, i);
+    return i;
+}
+
+// Free the page tables and the process table, the policies belong to the caller
+void procs_free(ProcTable *procs) {
+    for (int i = 0; i < procs->count; i++) {
+        pt_free(&procs->list[i].pt);
+    }
+    free(procs->list);
+    free(procs->index);
+}
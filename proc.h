@@ -0,0 +1,43 @@
+#ifndef PROC_H
+#define PROC_H
+
+#include "policy.h"
+#include "pt.h"
+
+// Process IDs must be below this, the process table indexes them directly
+#define PROC_MAX_PID 65536
+
+// Structs
+
+// Address space of one process of the trace
+typedef struct {
+    int pid; // process ID from the trace
+    PageTable pt; // page table root of the process
+    Policy *policy; // replacement policy of the process's frames, one policy shared by all with global replacement
+    long refs; // memory references made
+    long faults; // page faults taken
+    long rss; // resident pages (mappings)
+    long peak_rss; // largest resident set seen
+} Process;
+
+// Processes in the order they first appear in the trace, the index doubles as the address space ID
+typedef struct {
+    Process *list; // the processes
+    int count; // processes seen
+    int cap; // allocated entries of list
+    int *index; // index of each process ID in list, -1 if it has not appeared yet
+} ProcTable;
+
+
+// Function prototypes
+
+// Initialize an empty process table
+void procs_init(ProcTable *procs);
+// Index of a process, -1 if it has not appeared yet
+int proc_find(ProcTable *procs, int pid);
+// Add a process with an empty page table, returns its index
+int proc_add(ProcTable *procs, int pid, int levels, const int *bits, Policy *policy);
+// Free the page tables and the process table, the policies belong to the caller
+void procs_free(ProcTable *procs);
+
+#endif
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "log.h"
+#include "prof.h"
+
+// Nanoseconds per tick of prof_now(), measured once for all simulators
+static double ns_per_tick = 1.0;
+static pthread_once_t calibrated = PTHREAD_ONCE_INIT;
+
+// Names of the phases in reports
+static const char *phase_names[PROF_PHASES] = {"parse", "translate", "policy", "swap", "output"};
+
+// Measure the time stamp counter against the monotonic clock over a millisecond
+static void calibrate(void) {
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t ticks = prof_now();
+    long ns;
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        ns = (now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec);
+    } while (ns < 1000000);
+    ticks = prof_now() - ticks;
+    if (ticks > 0) {
+        ns_per_tick = (double)ns / ticks;
+    }
+}
+
+// Log2 bucket of a time in ns
+static int ns_bucket(long ns) {
+    return (ns > 1) ? 63 - __builtin_clzl(ns) : 0;
+}
+
+// Clear the probe results and calibrate the time stamp counter on first use
+void prof_init(Profile *prof) {
+    pthread_once(&calibrated, calibrate);
+    memset(prof, 0, sizeof(Profile));
+    prof->fault.victim_pid = -1;
+    prof->fault.victim_vpn = -1;
+    prof->start = prof_now();
+}
+
+// Add the time of one probe of a phase
+void prof_phase(Profile *prof, int phase, uint64_t ticks) {
+    prof->phase[phase] += ticks;
+    prof->calls[phase]++;
+}
+
+// Add the handling time of a reference to the hit or fault histogram
+void prof_ref(Profile *prof, int fault, uint64_t ticks) {
+    double ns = ticks * ns_per_tick;
+    if (fault) {
+        prof->fault_hist[ns_bucket((long)ns)]++;
+        prof->fault_ns += ns;
+    } else {
+        prof->hit_hist[ns_bucket((long)ns)]++;
+        prof->hit_ns += ns;
+    }
+}
+
+// Swap two faults of the heap
+static void swap_faults(ProfFault *a, ProfFault *b) {
+    ProfFault t = *a;
+    *a = *b;
+    *b = t;
+}
+
+// Keep the fault being handled if it is one of the slowest
+void prof_fault(Profile *prof, long ns) {
+    ProfFault *heap = prof->slowest;
+    prof->fault.ns = ns;
+    if (prof->slowest_count < PROF_SLOWEST) {
+        // Sift the new fault up
+        int i = prof->slowest_count++;
+        heap[i] = prof->fault;
+        while (i > 0 && heap[(i - 1) / 2].ns > heap[i].ns) {
+            swap_faults(&heap[(i - 1) / 2], &heap[i]);
+            i = (i - 1) / 2;
+        }
+    } else if (ns > heap[0].ns) {
+        // Replace the fastest of the slowest and sift it down
+        heap[0] = prof->fault;
+        int i = 0;
+        for (;;) {
+            int min = i;
+            int l = 2 * i + 1;
+            int r = l + 1;
+            if (l < PROF_SLOWEST && heap[l].ns < heap[min].ns) {
+                min = l;
+            }
+            if (r < PROF_SLOWEST && heap[r].ns < heap[min].ns) {
+                min = r;
+            }
+            if (min == i) {
+                break;
+            }
+            swap_faults(&heap[i], &heap[min]);
+            i = min;
+        }
+    }
+    // The next fault starts without a victim until one is chosen
+    prof->fault.victim_pid = -1;
+    prof->fault.victim_vpn = -1;
+    prof->fault.victim_dirty = 0;
+    prof->fault.travel = 0;
+}
+
+// Print the mean and the buckets of the 50th and 99th percentile of a latency histogram
+static void report_hist(const char *name, const long *hist, double total_ns) {
+    long count = 0;
+    for (int i = 0; i < 64; i++) {
+        count += hist[i];
+    }
+    if (count == 0) {
+        return;
+    }
+    long p50 = 0, p99 = 0, seen = 0;
+    for (int i = 0; i < 64; i++) {
+        seen += hist[i];
+        if (p50 == 0 && seen * 100 >= count * 50) {
+            p50 = 2L << i;
+        }
+        if (p99 == 0 && seen * 100 >= count * 99) {
+            p99 = 2L << i;
+        }
+    }
+    LOG_INFO("profile: %ld %s, mean %.0f ns, p50 < %ld ns, p99 < %ld ns", count, name, total_ns / count, p50, p99);
+}
+
+// Order of the slowest faults, slowest first
+static int cmp_faults(const void *a, const void *b) {
+    long na = ((const ProfFault *)a)->ns;
+    long nb = ((const ProfFault *)b)->ns;
+    return (na < nb) - (na > nb);
+}
+
+// Print the phase totals, the hit and fault latencies and the slowest faults that were recorded
+void prof_report(const Profile *prof) {
+    double total = (prof_now() - prof->start) * ns_per_tick;
+    for (int p = 0; p < PROF_PHASES; p++) {
+        if (prof->calls[p] == 0) {
+            continue;
+        }
+        double ns = prof->phase[p] * ns_per_tick;
+        LOG_INFO("profile: %-9s %10.3f ms, %5.1f%% of the run, %ld probes, %.1f ns each", phase_names[p], ns / 1e6,
+                 total > 0 ? 100.0 * ns / total : 0.0, prof->calls[p], ns / prof->calls[p]);
+    }
+    report_hist("hits", prof->hit_hist, prof->hit_ns);
+    report_hist("faults", prof->fault_hist, prof->fault_ns);
+
+    ProfFault slowest[PROF_SLOWEST];
+    int n = prof->slowest_count;
+    memcpy(slowest, prof->slowest, n * sizeof(ProfFault));
+    qsort(slowest, n, sizeof(ProfFault), cmp_faults);
+    for (int i = 0; i < n; i++) {
+        const ProfFault *f = &slowest[i];
+        if (f->victim_pid < 0) {
+            LOG_INFO("profile: slow fault %d: %ld ns at reference %ld, %c of vpn %ld of process %d into free frame %d",
+                     i + 1, f->ns, f->ref, f->type, f->vpn, f->pid, f->frame);
+        } else {
+            LOG_INFO("profile: slow fault %d: %ld ns at reference %ld, %c of vpn %ld of process %d into frame %d, "
+                     "evicted %s vpn %ld of process %d after examining %ld frames", i + 1, f->ns, f->ref, f->type,
+                     f->vpn, f->pid, f->frame, f->victim_dirty ? "dirty" : "clean", f->victim_vpn, f->victim_pid,
+                     f->travel);
+        }
+    }
+}
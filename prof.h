@@ -0,0 +1,110 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Timing probes, compiled in with make PROFILE=1 (MEMSIM_PROFILE) or PROFILE=faults (MEMSIM_PROFILE_FAULTS) and
+// compiled away otherwise. MEMSIM_PROFILE times the phases of every reference with the time stamp counter.
+// MEMSIM_PROFILE_FAULTS only keeps the slowest faults with their context, from the fault latency that is measured
+// anyway, so it costs nothing on hits.
+
+// Phases of the simulation
+#define PROF_PARSE 0 // decoding the trace
+#define PROF_TRANSLATE 1 // TLB lookup and page table walk
+#define PROF_POLICY 2 // replacement policy calls: hits, loads, victim selection and ticks
+#define PROF_SWAP 3 // backing store reads and writes
+#define PROF_OUTPUT 4 // formatting the translations into the output file
+#define PROF_PHASES 5
+
+// Number of slowest faults kept with their context
+#ifndef PROF_SLOWEST
+#define PROF_SLOWEST 10
+#endif
+
+// Structs
+
+// A page fault and what it took
+typedef struct {
+    long ns; // fault handling time
+    long ref; // reference that faulted
+    int pid; // process of the page
+    long vpn; // page that faulted
+    char type; // r or w
+    int frame; // frame the page was loaded into
+    int victim_pid; // process of the evicted page, -1 if the frame was free
+    long victim_vpn; // evicted page
+    int victim_dirty; // 1 if the evicted page was written back
+    long travel; // frames the clock hands examined to find the victim
+} ProfFault;
+
+// Probe results of one simulator. Phase times are in ticks of the time stamp counter, or in ns without one.
+typedef struct {
+    uint64_t phase[PROF_PHASES]; // time spent in each phase
+    long calls[PROF_PHASES]; // probes of each phase
+    long hit_hist[64]; // references that hit by handling time, bucket i counts [2^i, 2^(i+1)) ns
+    long fault_hist[64]; // references that faulted by handling time
+    double hit_ns; // total handling time of hits
+    double fault_ns; // total handling time of faults
+    uint64_t start; // when the simulator was set up
+    ProfFault fault; // context of the fault being handled
+    ProfFault slowest[PROF_SLOWEST]; // min-heap of the slowest faults, the fastest of them on top
+    int slowest_count; // faults in the heap
+} Profile;
+
+
+#if defined(MEMSIM_PROFILE) || defined(MEMSIM_PROFILE_FAULTS)
+#define PROF_INIT(prof) prof_init(prof)
+#define PROF_REPORT(prof) prof_report(prof)
+#else
+#define PROF_INIT(prof) ((void)0)
+#define PROF_REPORT(prof) ((void)0)
+#endif
+
+#ifdef MEMSIM_PROFILE
+#define PROF_START(t) uint64_t t = prof_now()
+#define PROF_STOP(prof, ph, t) prof_phase(prof, ph, prof_now() - (t))
+#define PROF_REF(prof, fault, t) prof_ref(prof, fault, prof_now() - (t))
+#else
+#define PROF_START(t) ((void)0)
+#define PROF_STOP(prof, ph, t) ((void)0)
+#define PROF_REF(prof, fault, t) ((void)0)
+#endif
+
+#ifdef MEMSIM_PROFILE_FAULTS
+#define PROF_FAULT(prof, field, value) ((prof)->fault.field = (value))
+#define PROF_FAULT_DONE(prof, ns) prof_fault(prof, ns)
+#else
+#define PROF_FAULT(prof, field, value) ((void)0)
+#define PROF_FAULT_DONE(prof, ns) ((void)0)
+#endif
+
+
+// Function prototypes
+
+// Current time in ticks of the time stamp counter, or in ns without one
+static inline uint64_t prof_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+// Clear the probe results and calibrate the time stamp counter on first use
+void prof_init(Profile *prof);
+// Add the time of one probe of a phase
+void prof_phase(Profile *prof, int phase, uint64_t ticks);
+// Add the handling time of a reference to the hit or fault histogram
+void prof_ref(Profile *prof, int fault, uint64_t ticks);
+// Keep the fault being handled if it is one of the slowest
+void prof_fault(Profile *prof, long ns);
+// Print the phase totals, the hit and fault latencies and the slowest faults that were recorded
+void prof_report(const Profile *prof);
+
+#endif
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "log.h"
+#include "pt.h"
+
+// Allocate an empty table for a level, pointer tables start out NULL and PTEs invalid
+static void *pt_alloc(PageTable *pt, int level) {
+    size_t entry_size = (level == pt->levels - 1) ? sizeof(PTE) : sizeof(void *);
+    size_t size = ((size_t)1 << pt->bits[level]) * entry_size;
+    void *table = calloc(1, size);
+    if (table == NULL) {
+        fatal("Out of memory for the page tables");
+    }
+    pt->tables[level]++;
+    pt->bytes += size;
+    return table;
+}
+
+// Free a table and everything below it
+static void pt_free_table(PageTable *pt, void *table, int level) {
+    if (level < pt->levels - 1) {
+        void **slots = table;
+        for (size_t i = 0; i < ((size_t)1 << pt->bits[level]); i++) {
+            if (slots[i] != NULL) {
+                pt_free_table(pt, slots[i], level + 1);
+            }
+        }
+    }
+    free(table);
+}
+
+// Set up a page table with the given index bits per level and allocate its root
+void pt_init(PageTable *pt, int levels, const int *bits) {
+    pt->levels = levels;
+    pt->bytes = 0;
+    int shift = 0;
+    for (int l = levels - 1; l >= 0; l--) {
+        pt->bits[l] = bits[l];
+        pt->shift[l] = shift;
+        pt->tables[l] = 0;
+        shift += bits[l];
+    }
+    pt->root = pt_alloc(pt, 0);
+}
+
+// Find the page table entry of a virtual page, allocating the tables on the way if needed
+PTE *pt_lookup(PageTable *pt, uint64_t vpn) {
+    void *table = pt->root;
+    for (int l = 0; l < pt->levels - 1; l++) {
+        void **slots = table;
+        uint64_t index = (vpn >> pt->shift[l]) & ((1u << pt->bits[l]) - 1);
+        if (slots[index] == NULL) {
+            slots[index] = pt_alloc(pt, l + 1);
+        }
+        table = slots[index];
+    }
+    return &((PTE *)table)[vpn & ((1u << pt->bits[pt->levels - 1]) - 1)];
+}
+
+// Free all the tables
+void pt_free(PageTable *pt) {
+    pt_free_table(pt, pt->root, 0);
+    pt->root = NULL;
+}
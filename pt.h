@@ -0,0 +1,36 @@
+#ifndef PT_H
+#define PT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "memsim.h"
+
+// Limits of the radix page table
+#define PT_MAX_LEVELS 4
+#define PT_MAX_BITS 20 // largest index at one level, so that no single table exceeds 4 MB
+
+// Structs
+
+// Radix page table. Every level but the last holds pointers to the tables of the next level, the last level holds
+// PTEs. Only the root is allocated up front, the other tables are allocated the first time a page under them is used.
+typedef struct {
+    int levels; // number of levels, 1 to PT_MAX_LEVELS
+    int bits[PT_MAX_LEVELS]; // index bits of each level, from the root down
+    int shift[PT_MAX_LEVELS]; // position of each level's index in the virtual page number
+    void *root; // top-level table
+    long tables[PT_MAX_LEVELS]; // tables allocated at each level
+    size_t bytes; // memory used by all the tables
+} PageTable;
+
+
+// Function prototypes
+
+// Set up a page table with the given index bits per level and allocate its root
+void pt_init(PageTable *pt, int levels, const int *bits);
+// Find the page table entry of a virtual page, allocating the tables on the way if needed
+PTE *pt_lookup(PageTable *pt, uint64_t vpn);
+// Free all the tables
+void pt_free(PageTable *pt);
+
+#endif
@@ -0,0 +1,117 @@
+#include <stdlib.h>
+
+#include "log.h"
+#include "ra.h"
+
+// Initialize the readahead engine with the largest window in pages
+void ra_init(Readahead *ra, int max_window) {
+    for (int i = 0; i < RA_STREAMS; i++) {
+        ra->streams[i].asid = 0;
+        ra->streams[i].last = -RA_MAX_STRIDE - 1;  // never close to a real page
+        ra->streams[i].stride = 0;
+        ra->streams[i].confirmed = 0;
+        ra->streams[i].next = 0;
+        ra->streams[i].window = 0;
+        ra->streams[i].stamp = 0;
+    }
+    ra->max_window = (max_window < RA_MAX_WINDOW) ? max_window : RA_MAX_WINDOW;
+    ra->clock = 0;
+    ra->batches = 0;
+    ra->issued = 0;
+    ra->used = 0;
+    ra->wasted = 0;
+}
+
+// Plan the next window of a stream, returns the number of pages to prefetch
+static int ra_plan(Readahead *ra, RaStream *s, RaRequest *req) {
+    req->stream = (int)(s - ra->streams);
+    req->asid = s->asid;
+    req->start = s->next;
+    req->stride = s->stride;
+    req->count = s->window;
+    s->next += s->window * s->stride;
+    ra->batches++;
+    return req->count;
+}
+
+// Record a page fault in address space asid, returns the number of pages to prefetch and fills req with them
+int ra_on_fault(Readahead *ra, int asid, long vpn, RaRequest *req) {
+    RaStream *s = NULL;
+
+    // A fault one stride after the last page continues a stream of the same address space
+    for (int i = 0; i < RA_STREAMS && s == NULL; i++) {
+        RaStream *c = &ra->streams[i];
+        if (c->asid == asid && c->stride != 0 && vpn - c->last == c->stride) {
+            s = c;
+            s->confirmed = 1;
+        }
+    }
+    // A fault close to the last page of a stream gives it a new stride
+    for (int i = 0; i < RA_STREAMS && s == NULL; i++) {
+        RaStream *c = &ra->streams[i];
+        if (c->asid == asid && vpn != c->last && labs(vpn - c->last) <= RA_MAX_STRIDE) {
+            s = c;
+            s->stride = (int)(vpn - c->last);
+            s->confirmed = 0;
+        }
+    }
+    // Otherwise start a new stream in place of the least recently used one
+    if (s == NULL) {
+        s = &ra->streams[0];
+        for (int i = 1; i < RA_STREAMS; i++) {
+            if (ra->streams[i].stamp < s->stamp) {
+                s = &ra->streams[i];
+            }
+        }
+        s->asid = asid;
+        s->stride = 0;
+        s->confirmed = 0;
+    }
+
+    s->last = vpn;
+    s->stamp = ++ra->clock;
+    if (!s->confirmed) {
+        return 0;
+    }
+
+    // The stream faulted, so whatever was prefetched is behind it: restart the window at the fault
+    if (s->window == 0) {
+        s->window = (ra->max_window < 4) ? ra->max_window : 4;
+    }
+    s->next = vpn + s->stride;
+    LOG_DEBUG("readahead: stream %d stride %d window %d after fault on vpn %ld", (int)(s - ra->streams), s->stride,
+              s->window, vpn);
+    return ra_plan(ra, s, req);
+}
+
+// Record the first reference to a page prefetched for a stream, returns the pages to prefetch like ra_on_fault
+int ra_on_use(Readahead *ra, int stream, long vpn, RaRequest *req) {
+    RaStream *s = &ra->streams[stream];
+    ra->used++;
+    if (s->stride == 0 || (vpn - s->last) % s->stride != 0) {
+        return 0;  // the stream slot was taken over since the page was prefetched
+    }
+    s->last = vpn;
+    s->stamp = ++ra->clock;
+
+    // Prefetch the next window once half of the current one is used, doubling it since it paid off
+    if ((s->next - vpn) / s->stride > s->window / 2) {
+        return 0;
+    }
+    s->window = (s->window * 2 < ra->max_window) ? s->window * 2 : ra->max_window;
+    return ra_plan(ra, s, req);
+}
+
+// Record the eviction of a page prefetched for a stream that was never referenced
+void ra_on_waste(Readahead *ra, int stream) {
+    RaStream *s = &ra->streams[stream];
+    ra->wasted++;
+    if (s->window > 1) {
+        s->window /= 2;
+    }
+}
+
+// Record the pages of a request that were actually prefetched, the others were resident already
+void ra_on_issue(Readahead *ra, int count) {
+    ra->issued += count;
+}
@@ -0,0 +1,56 @@
+#ifndef RA_H
+#define RA_H
+
+// Readahead tunables
+#define RA_STREAMS 8 // streams tracked at once, the least recently used one is replaced
+#define RA_MAX_STRIDE 8 // largest distance in pages between two faults of the same stream
+#define RA_MAX_WINDOW 32 // largest number of pages prefetched at once
+
+// Structs
+
+// Stream of faults walking the address space with a constant stride
+typedef struct {
+    int asid; // address space the stream walks
+    long last; // last page of the stream that was faulted on or used
+    int stride; // distance in pages between consecutive pages of the stream, 0 until known
+    int confirmed; // 1 once the same stride was seen on two faults in a row
+    long next; // first page after the ones already prefetched
+    int window; // pages prefetched at once, grows while prefetches are used and shrinks when they are not
+    long stamp; // time of the last fault or use, to find the least recently used stream
+} RaStream;
+
+// Pages to prefetch for a stream: count pages start, start + stride, ...
+typedef struct {
+    int stream; // index of the stream
+    int asid; // address space of the pages
+    long start; // first page
+    int stride; // distance between the pages
+    int count; // number of pages
+} RaRequest;
+
+// Readahead engine: detects sequential and strided streams and decides what to prefetch
+typedef struct {
+    RaStream streams[RA_STREAMS]; // streams being tracked
+    int max_window; // upper bound of the window
+    long clock; // counts stream updates, source of the stamps
+    long batches; // prefetch requests issued
+    long issued; // pages prefetched
+    long used; // prefetched pages referenced before eviction
+    long wasted; // prefetched pages evicted without being referenced
+} Readahead;
+
+
+// Function prototypes
+
+// Initialize the readahead engine with the largest window in pages
+void ra_init(Readahead *ra, int max_window);
+// Record a page fault in address space asid, returns the number of pages to prefetch and fills req with them
+int ra_on_fault(Readahead *ra, int asid, long vpn, RaRequest *req);
+// Record the first reference to a page prefetched for a stream, returns the pages to prefetch like ra_on_fault
+int ra_on_use(Readahead *ra, int stream, long vpn, RaRequest *req);
+// Record the eviction of a page prefetched for a stream that was never referenced
+void ra_on_waste(Readahead *ra, int stream);
+// Record the pages of a request that were actually prefetched, the others were resident already
+void ra_on_issue(Readahead *ra, int count);
+
+#endif
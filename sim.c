@@ -0,0 +1,756 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+#include "log.h"
+#include "sim.h"
+
+// Parse the index bits of each page table level, or split the page number evenly if spec is empty
+static void parse_level_bits(SimConfig *cfg, const char *spec) {
+    int vpn_bits = cfg->va_bits - cfg->page_shift;
+    if (spec[0] == '\0') {
+        // The upper levels take the bits that do not divide evenly
+        for (int l = 0; l < cfg->level; l++) {
+            cfg->level_bits[l] = vpn_bits / cfg->level + (l < vpn_bits % cfg->level);
+        }
+    } else {
+        int n = 0;
+        for (const char *p = spec; *p != '\0'; n++) {
+            if (n == cfg->level) {
+                fatal("-b gives more than %d levels", cfg->level);
+            }
+            char *end;
+            cfg->level_bits[n] = (int)strtol(p, &end, 10);
+            p = (*end == ',') ? end + 1 : end;
+            if (end == p && *end != '\0') {
+                fatal("Wrong page table index bits %s", spec);
+            }
+        }
+        if (n != cfg->level) {
+            fatal("-b gives %d levels, the page table has %d", n, cfg->level);
+        }
+    }
+
+    int total = 0;
+    for (int l = 0; l < cfg->level; l++) {
+        if (cfg->level_bits[l] < 1 || cfg->level_bits[l] > PT_MAX_BITS) {
+            fatal("Each page table level needs 1 to %d index bits, use more levels", PT_MAX_BITS);
+        }
+        total += cfg->level_bits[l];
+    }
+    if (total != vpn_bits) {
+        fatal("The page table levels index %d bits, %d bit addresses have %d bit page numbers", total, cfg->va_bits,
+              vpn_bits);
+    }
+}
+
+// Check a configuration and derive the mapping size and swap layout, bits_spec gives the index bits of each level
+// (split evenly if empty)
+void sim_config_check(SimConfig *cfg, const char *bits_spec) {
+    if (cfg->level < 1 || cfg->level > PT_MAX_LEVELS) {
+        fatal("Wrong number of levels in the page table");
+    }
+    if (cfg->va_bits != 16 && cfg->va_bits != 32 && cfg->va_bits != 39 && cfg->va_bits != 48) {
+        fatal("Wrong virtual address width, use 16, 32, 39 or 48 bits");
+    }
+    if (cfg->page_size < 64 || cfg->page_size > (1 << 20) || (cfg->page_size & (cfg->page_size - 1)) != 0) {
+        fatal("Wrong page size, use a power of two from 64 to 1048576 bytes");
+    }
+    cfg->page_shift = __builtin_ctz(cfg->page_size);
+    if (cfg->page_shift >= cfg->va_bits) {
+        fatal("The page size does not fit in %d bit addresses", cfg->va_bits);
+    }
+    parse_level_bits(cfg, bits_spec);
+    if (cfg->fcount < 4 || cfg->fcount > MAX_FRAMES) {
+        fatal("Wrong number of frames in the physical memory");
+    }
+
+    // A huge page is mapped one level above the last, so it covers as many base pages as a last-level table
+    if (cfg->huge != 0 && cfg->huge != 1) {
+        fatal("Wrong huge page mode, use 0 or 1");
+    }
+    if (cfg->huge && cfg->level < 2) {
+        fatal("Huge pages need at least two page table levels");
+    }
+    cfg->map_shift = cfg->page_shift + (cfg->huge ? cfg->level_bits[cfg->level - 1] : 0);
+    cfg->map_size = 1 << cfg->map_shift;
+    int pages_per_map = cfg->map_size / cfg->page_size;
+    if (cfg->map_shift > 30 || cfg->fcount % pages_per_map != 0 || cfg->fcount / pages_per_map < 2) {
+        fatal("The frames must hold at least two %d byte huge pages", cfg->map_size);
+    }
+    cfg->page_count = 1L << (cfg->va_bits - cfg->map_shift);
+    cfg->swap_direct = (cfg->page_count <= (1L << 20));
+    if (policy_lookup(cfg->algo) == NULL) {
+        fatal("Wrong page replacement algorithm");
+    }
+    if (policy_lookup(cfg->algo)->offline && cfg->ra_window > 0) {
+        fatal("%s knows the next use of referenced pages only, drop readahead (-R)", cfg->algo);
+    }
+    if (cfg->io_mode < 0) {
+        fatal("Wrong swap I/O mode");
+    }
+    if (cfg->wb_depth < 0 || cfg->clean_batch < 0) {
+        fatal("Wrong writeback queue depth or cleaning batch");
+    }
+    if (cfg->clean_batch > 0 && cfg->wb_depth == 0) {
+        fatal("Proactive cleaning (-c) needs the writeback thread (-w)");
+    }
+    if (cfg->wb_depth > 0 && cfg->io_mode == BS_MEM) {
+        fatal("The writeback thread (-w) needs a swap file, not private memory");
+    }
+    if (cfg->tlb_size < 0 || cfg->tlb_policy < 0) {
+        fatal("Wrong TLB configuration");
+    }
+    if (cfg->ra_window < 0) {
+        fatal("Wrong readahead window");
+    }
+    if (cfg->tick < 1) {
+        fatal("Wrong timer tick period");
+    }
+    if (cfg->ws_window < 0) {
+        fatal("Wrong working-set window");
+    }
+}
+
+// Working-set window of a configuration in ticks, at least one
+static int ws_ticks(const SimConfig *cfg) {
+    int ticks = (cfg->ws_window > 0) ? cfg->ws_window / cfg->tick : 8;
+    return (ticks > 0) ? ticks : 1;
+}
+
+// Set up a simulator with empty frames and page tables over the given swap file. An offline policy (OPT) needs the
+// next-use index of the trace from trace_next_use() at the mapping size, NULL otherwise.
+void sim_init(Sim *sim, const SimConfig *cfg, const char *swapfile, const long *next_use) {
+    sim->cfg = *cfg;
+    if (policy_lookup(cfg->algo)->offline && next_use == NULL) {
+        fatal("%s needs the next-use index of the trace", cfg->algo);
+    }
+    sim->next_use = next_use;
+    int frames = cfg->fcount / (cfg->map_size / cfg->page_size);
+
+    // Initialize the frame table, all frames start out empty
+    FrameTable *ft = &sim->ft;
+    ft->size = frames;
+    ft->used = 0;
+    ft->words = (frames + 63) / 64;
+    ft->entries = malloc(ft->size * sizeof(FrameInfo));
+    ft->r = calloc(ft->words, sizeof(uint64_t));
+    ft->m = calloc(ft->words, sizeof(uint64_t));
+    ft->v = calloc(ft->words, sizeof(uint64_t));
+    if (ft->entries == NULL || ft->r == NULL || ft->m == NULL || ft->v == NULL) {
+        fatal("Cannot allocate the frame table");
+    }
+    for (int i = 0; i < ft->size; i++) {
+        ft->entries[i].vpn = -1;
+        ft->entries[i].slot = -1;
+        ft->entries[i].proc = 0;
+        ft->entries[i].ra = 0;
+        ft->entries[i].load_time = 0;
+        ft->entries[i].next_use = LONG_MAX;
+        ft->entries[i].prev = -1;
+        ft->entries[i].next = -1;
+    }
+
+    // Initialize the physical memory, frames are the size of a mapping
+    sim->pm.size = frames;
+    sim->pm.frame_size = cfg->map_size;
+    sim->pm.frames = calloc(frames, cfg->map_size);  // untouched frames cost no memory until they are used
+    if (sim->pm.frames == NULL) {
+        fatal("Cannot allocate %d frames of %d bytes", frames, cfg->map_size);
+    }
+
+    // Bind the page replacement algorithm once, the simulation loop only calls through it. With global replacement
+    // all processes share one policy, with local replacement each process gets its own as it appears.
+    sim->policy = cfg->local_repl ? NULL : policy_create(cfg->algo, ft, ws_ticks(cfg));
+    procs_init(&sim->procs);
+    sim->proc = NULL;
+    sim->asid = -1;
+
+    // Initialize the TLB
+    if (cfg->tlb_size > 0) {
+        tlb_init(&sim->tlb, cfg->tlb_size, cfg->tlb_ways, cfg->tlb_policy);
+    }
+
+    // Initialize the backing store, 1024 pages of 64 bytes by default, created with all 0s if it doesn't exist.
+    // Slots are handed out as pages are written, past the pages held at their vpn, and are written with positional
+    // I/O so the file can grow.
+    int io_mode = (cfg->swap_direct || cfg->io_mode == BS_MEM) ? cfg->io_mode : BS_PIO;
+    bs_open(&sim->bs, swapfile, cfg->swap_direct ? cfg->page_count : 0, cfg->map_size, io_mode);
+    sim->next_slot = cfg->swap_direct ? cfg->page_count : 0;
+
+    // A window is at most a quarter of the frames, so that LRU does not push out prefetched pages before their use
+    ra_init(&sim->ra, (cfg->ra_window < frames / 4) ? cfg->ra_window : frames / 4);
+    sim->ra_pending = 0;
+
+    // Start the writeback thread if dirty pages are written in the background
+    sim->wb = NULL;
+    if (cfg->wb_depth > 0) {
+        sim->wb = &sim->writeback;
+        wb_start(sim->wb, &sim->bs, cfg->wb_depth);
+    }
+    sim->clean_cursor = 0;
+
+    sim->ref_count = 0;
+    sim->pfault_count = 0;
+    memset(sim->fault_latency, 0, sizeof(sim->fault_latency));
+    sim->fault_latency_max = 0;
+    sim->fault_latency_total = 0;
+    sim->stats_out = NULL;
+    sim->stats_every = 0;
+    PROF_INIT(&sim->prof);
+}
+
+// Keep detailed statistics and write them to a JSON file at the end of the run, and every `every` references if
+// every > 0. Each snapshot is one line.
+void sim_stats_open(Sim *sim, const char *path, long every) {
+    sim->stats_out = fopen(path, "w");
+    if (sim->stats_out == NULL) {
+        fatal("Cannot create %s", path);
+    }
+    sim->stats_every = every;
+    stats_init(&sim->stats, sim->cfg.tick);  // the resident set is sampled on ticks
+}
+
+// Index of a process in the process table, adding it on its first reference
+static int process_index(Sim *sim, int pid) {
+    int i = proc_find(&sim->procs, pid);
+    if (i < 0) {
+        SimConfig *cfg = &sim->cfg;
+        Policy *policy = cfg->local_repl ? policy_create(cfg->algo, &sim->ft, ws_ticks(cfg)) : sim->policy;
+        i = proc_add(&sim->procs, pid, cfg->huge ? cfg->level - 1 : cfg->level, cfg->level_bits, policy);
+    }
+    return i;
+}
+
+// 1 if the pages of a process live at their vpn in the backing store, 0 if they are given slots
+static int swap_direct_proc(Sim *sim, int asid) {
+    return sim->cfg.swap_direct && sim->procs.list[asid].pid == 0;
+}
+
+// Location of a non-resident page in the backing store, -1 if it was never written out
+static long page_slot(Sim *sim, int asid, long vpn, PTE *pte) {
+    if (swap_direct_proc(sim, asid)) {
+        return vpn;
+    }
+    return pte->s ? (long)pte->frame : -1;
+}
+
+// Swap slot of the page in a frame, giving it one if it has none
+static long frame_slot(Sim *sim, FrameInfo *fi) {
+    if (fi->slot < 0) {
+        if (sim->next_slot == (1L << 30)) {
+            fatal("Out of swap slots");
+        }
+        fi->slot = sim->next_slot++;
+    }
+    return fi->slot;
+}
+
+// Process that gives up a page when process asid needs a frame
+static int victim_process(Sim *sim, int asid) {
+    if (!sim->cfg.local_repl) {
+        return asid;  // the shared policy picks among the pages of every process
+    }
+    // A process holding its share of the frames replaces its own pages, a smaller one takes a frame from the
+    // process holding the most
+    ProcTable *procs = &sim->procs;
+    Process *p = &procs->list[asid];
+    if (p->rss > 0 && p->rss >= sim->ft.size / procs->count) {
+        return asid;
+    }
+    int victim = asid;
+    for (int i = 0; i < procs->count; i++) {
+        if (procs->list[i].rss > procs->list[victim].rss) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+// Get a frame for virtual page vpn of process asid, evicting a page if physical memory is full
+static int take_frame(Sim *sim, int asid, long vpn) {
+    FrameTable *ft = &sim->ft;
+    if (ft->used < ft->size) {
+        // Use the next empty frame
+        bitmap_set(ft->v, ft->used);
+        return ft->used++;
+    }
+
+    // No empty frame, let the replacement algorithm pick a victim
+    Policy *policy = sim->procs.list[victim_process(sim, asid)].policy;
+    long travel = policy->travel;
+    PROF_START(select);
+    int frame = policy->ops->select_victim(policy, asid, vpn);
+    PROF_STOP(&sim->prof, PROF_POLICY, select);
+    FrameInfo *victim = &ft->entries[frame];
+    Process *owner = &sim->procs.list[victim->proc];
+    PROF_FAULT(&sim->prof, victim_pid, owner->pid);
+    PROF_FAULT(&sim->prof, victim_vpn, victim->vpn);
+    PROF_FAULT(&sim->prof, victim_dirty, frame_m(ft, frame));
+    PROF_FAULT(&sim->prof, travel, policy->travel - travel);
+    LOG_DEBUG("victim page: %ld of process %d frame: %d dirty: %d", victim->vpn, owner->pid, frame,
+              frame_m(ft, frame));
+    if (sim->stats_out != NULL) {
+        stats_evict(&sim->stats, frame_m(ft, frame), policy->travel - travel);
+    }
+
+    // Write the victim page to the backing store if it is modified
+    if (frame_m(ft, frame)) {
+        PROF_START(page_out);
+        if (sim->wb != NULL) {
+            wb_enqueue(sim->wb, frame_slot(sim, victim), frame_data(&sim->pm, frame));
+        } else {
+            bs_page_out(&sim->bs, frame_slot(sim, victim), frame_data(&sim->pm, frame));
+        }
+        PROF_STOP(&sim->prof, PROF_SWAP, page_out);
+    }
+
+    // A prefetched page leaving unused means its stream prefetches too far ahead
+    if (victim->ra != 0) {
+        ra_on_waste(&sim->ra, victim->ra - 1);
+    }
+
+    // The victim is no longer resident, its PTE keeps its swap slot
+    PTE *pte = pt_lookup(&owner->pt, victim->vpn);
+    pte->v = 0;
+    if (!swap_direct_proc(sim, victim->proc) && victim->slot >= 0) {
+        pte->frame = victim->slot;
+        pte->s = 1;
+    }
+    if (sim->cfg.tlb_size > 0) {
+        tlb_invalidate(&sim->tlb, victim->proc, victim->vpn);
+    }
+    owner->rss--;
+    return frame;
+}
+
+// Map a virtual page of process asid to a frame and reset the frame's replacement state
+static void map_page(Sim *sim, int asid, long vpn, PTE *pte, int frame) {
+    // Update the frame table, the swap slot moves from the PTE to the frame while the page is resident
+    FrameInfo *fi = &sim->ft.entries[frame];
+    fi->vpn = vpn;
+    fi->proc = asid;
+    fi->slot = page_slot(sim, asid, vpn, pte);
+    frame_set_r(&sim->ft, frame);
+    frame_clear_m(&sim->ft, frame);
+    fi->ra = 0;
+    fi->load_time = sim->ref_count;
+    fi->next_use = (sim->next_use != NULL) ? sim->next_use[sim->ref_count] : LONG_MAX;
+
+    // Update the page table
+    pte->frame = frame;
+    pte->s = 0;
+    pte->v = 1;
+
+    Process *p = &sim->procs.list[asid];
+    if (++p->rss > p->peak_rss) {
+        p->peak_rss = p->rss;
+    }
+    PROF_START(insert);
+    p->policy->ops->on_fault_insert(p->policy, frame);
+    PROF_STOP(&sim->prof, PROF_POLICY, insert);
+}
+
+// Load a virtual page of process asid into a frame, evicting a page if physical memory is full, returns the frame
+static int handle_fault(Sim *sim, int asid, long vpn) {
+    int frame = take_frame(sim, asid, vpn);
+    LOG_DEBUG("vpn %ld of process %d loaded into frame %d", vpn, sim->procs.list[asid].pid, frame);
+    PROF_FAULT(&sim->prof, frame, frame);
+
+    // Load the page, from the writeback queue if its newest contents have not reached the backing store yet
+    PTE *pte = pt_lookup(&sim->procs.list[asid].pt, vpn);
+    long slot = page_slot(sim, asid, vpn, pte);
+    uint8_t *data = frame_data(&sim->pm, frame);
+    if (slot < 0) {
+        memset(data, 0, sim->cfg.map_size);  // never written out, still all 0s
+    } else if (sim->wb == NULL || !wb_lookup(sim->wb, slot, data)) {
+        PROF_START(page_in);
+        bs_page_in(&sim->bs, slot, data);
+        PROF_STOP(&sim->prof, PROF_SWAP, page_in);
+    }
+    map_page(sim, asid, vpn, pte, frame);
+    return frame;
+}
+
+// Prefetch the pages of a readahead request that are not resident, reading consecutive pages at once
+static void prefetch(Sim *sim, RaRequest *req) {
+    PageTable *pt = &sim->procs.list[req->asid].pt;
+    PM *pm = &sim->pm;
+    int frames[RA_MAX_WINDOW];  // frames the pages were prefetched into
+    void *run[RA_MAX_WINDOW];  // frames of the consecutive pages waiting to be read
+    long run_start = 0;  // swap slot of the first page of the run
+    int run_len = 0;  // number of pages in the run
+    int issued = 0;  // pages prefetched
+
+    // One step past the last page flushes the final run
+    for (int i = 0; i <= req->count; i++) {
+        long vpn = req->start + (long)i * req->stride;
+        PTE *pte = (i < req->count && vpn >= 0 && vpn < sim->cfg.page_count) ? pt_lookup(pt, vpn) : NULL;
+        int fetch = (pte != NULL && pte->v == 0);
+        long slot = fetch ? page_slot(sim, req->asid, vpn, pte) : -1;
+
+        // Read the run once this page does not extend it
+        if (run_len > 0 && (!fetch || slot != run_start + run_len)) {
+            PROF_START(batch);
+            bs_page_in_batch(&sim->bs, run_start, run_len, run);
+            PROF_STOP(&sim->prof, PROF_SWAP, batch);
+            run_len = 0;
+        }
+        if (!fetch) {
+            continue;
+        }
+
+        int frame = take_frame(sim, req->asid, vpn);
+        for (int j = 0; j < run_len; j++) {
+            if (run[j] == frame_data(pm, frame)) {
+                // A page of this batch was evicted, finish reading the run before its frame is reused
+                PROF_START(batch);
+                bs_page_in_batch(&sim->bs, run_start, run_len, run);
+                PROF_STOP(&sim->prof, PROF_SWAP, batch);
+                run_len = 0;
+            }
+        }
+        map_page(sim, req->asid, vpn, pte, frame);
+        sim->ft.entries[frame].ra = req->stream + 1;
+        frames[issued++] = frame;
+        LOG_DEBUG("vpn %ld prefetched into frame %d", vpn, frame);
+
+        if (slot < 0) {
+            memset(frame_data(pm, frame), 0, sim->cfg.map_size);  // never written out, still all 0s
+            continue;
+        }
+        if (sim->wb != NULL && wb_lookup(sim->wb, slot, frame_data(pm, frame))) {
+            continue;  // the newest copy is still in the writeback queue
+        }
+        if (run_len == 0) {
+            run_start = slot;
+        }
+        run[run_len++] = frame_data(pm, frame);
+    }
+
+    // The pages kept R set so that the batch would not evict itself, now they start unreferenced
+    // so that CLOCK and ECLOCK give them up before pages that were actually used
+    for (int i = 0; i < issued; i++) {
+        frame_clear_r(&sim->ft, frames[i]);
+    }
+    ra_on_issue(&sim->ra, issued);
+}
+
+// Queue dirty pages that were not referenced since the last tick for writeback and clear their M bits
+static void clean_frames(Sim *sim) {
+    FrameTable *ft = &sim->ft;
+    int budget = sim->cfg.clean_batch;
+    // Look at a bounded number of frames per tick, a pass over millions of clean frames would stall the simulation.
+    // The candidates of 64 frames at a time are the dirty, unreferenced and valid bits of a word.
+    long scan = (long)sim->cfg.clean_batch * 16;
+    for (long seen = 0; seen < ft->used && seen < scan && budget > 0;) {
+        int frame = sim->clean_cursor;
+        int w = frame >> 6;
+        uint64_t dirty = ft->m[w] & ~ft->r[w] & ft->v[w] & (~0ull << (frame & 63));
+        if (dirty == 0) {
+            // Nothing left in this word, move to the next one
+            seen += 64 - (frame & 63);
+            sim->clean_cursor = ((w + 1) << 6 < ft->used) ? (w + 1) << 6 : 0;
+            continue;
+        }
+        frame = (w << 6) + __builtin_ctzll(dirty);
+        if (!wb_try_enqueue(sim->wb, frame_slot(sim, &ft->entries[frame]), frame_data(&sim->pm, frame))) {
+            break;  // queue full, try again on the next tick
+        }
+        frame_clear_m(ft, frame);
+        budget--;
+        seen += frame - sim->clean_cursor + 1;
+        sim->clean_cursor = (frame + 1 < ft->used) ? frame + 1 : 0;
+    }
+}
+
+// Add a fault handling time to the latency histogram
+static void record_fault_latency(Sim *sim, struct timespec *start, struct timespec *end) {
+    long ns = (end->tv_sec - start->tv_sec) * 1000000000L + (end->tv_nsec - start->tv_nsec);
+    int bucket = (ns > 0) ? 63 - __builtin_clzl(ns) : 0;
+    sim->fault_latency[bucket]++;
+    sim->fault_latency_total += ns;
+    if (ns > sim->fault_latency_max) {
+        sim->fault_latency_max = ns;
+    }
+    PROF_FAULT_DONE(&sim->prof, ns);
+}
+
+// Simulate one memory reference and write its translation to out (if not NULL), returns 1 on a page fault
+int sim_ref(Sim *sim, const Ref *ref, Writer *out) {
+    SimConfig *cfg = &sim->cfg;
+    FrameTable *ft = &sim->ft;
+    PROF_START(ref_start);
+
+    // clear the R bits in the frame table every tick memory references
+    if (sim->ref_count != 0 && sim->ref_count % cfg->tick == 0) {
+        if (sim->wb != NULL && cfg->clean_batch > 0) {
+            clean_frames(sim);
+        }
+        // The policies see the R bits of the tick that ends before they are cleared
+        PROF_START(tick);
+        for (int i = 0; i < sim->procs.count && (cfg->local_repl || i == 0); i++) {
+            Policy *p = sim->procs.list[i].policy;
+            if (p->ops->on_tick != NULL) {
+                p->ops->on_tick(p);
+            }
+        }
+        PROF_STOP(&sim->prof, PROF_POLICY, tick);
+        frame_clear_all_r(ft);
+        if (sim->stats_out != NULL) {
+            stats_sample(&sim->stats, sim->ref_count, ft->used);
+        }
+    }
+    if (sim->stats_every > 0 && sim->ref_count != 0 && sim->ref_count % sim->stats_every == 0) {
+        stats_write(&sim->stats, sim->stats_out, sim->ref_count, &sim->procs, 0);
+    }
+
+    // Switch to the address space of the process, creating it on its first reference
+    if (sim->proc == NULL || ref->pid != sim->proc->pid) {
+        sim->asid = process_index(sim, ref->pid);
+        sim->proc = &sim->procs.list[sim->asid];
+    }
+    Process *proc = sim->proc;
+    int asid = sim->asid;
+    proc->refs++;
+
+    if ((ref->addr >> cfg->va_bits) != 0) {
+        fatal("Address 0x%llx of reference %ld is outside the %d bit address space",
+              (unsigned long long)ref->addr, sim->ref_count, cfg->va_bits);
+    }
+
+    // Translate the virtual address to a physical address
+    long vpn = ref->addr >> cfg->map_shift;  // virtual page number
+    int offset = ref->addr & (cfg->map_size - 1);  // offset
+    // PTE1 is the index in the top-level table, PTE2 the rest of the base page number. With single-level paging
+    // PTE1 is the page number and PTE2 is 0, with two levels PTE2 is the index in the inner table.
+    int top_shift = proc->pt.shift[0] + cfg->map_shift - cfg->page_shift;  // position of the top-level index
+    uint64_t pte1 = ref->addr >> cfg->page_shift >> top_shift;  // page table entry 1
+    uint64_t pte2 = (ref->addr >> cfg->page_shift) & ((1L << top_shift) - 1);  // page table entry 2
+
+    int pageFault = 0;  // page fault flag
+
+    LOG_TRACE("ref %ld: pid %d %c 0x%04llx vpn: %ld offset: %d pte1: %llu pte2: %llu", sim->ref_count, ref->pid,
+              ref->type, (unsigned long long)ref->addr, vpn, offset, (unsigned long long)pte1,
+              (unsigned long long)pte2);
+
+    // On a TLB miss, walk the page table of the process
+    int pfn;  // physical frame number
+    PROF_START(walk);
+    int tlb_hit = cfg->tlb_size > 0 && tlb_lookup(&sim->tlb, asid, vpn, &pfn);
+    PTE *pte = tlb_hit ? NULL : pt_lookup(&proc->pt, vpn);
+    PROF_STOP(&sim->prof, PROF_TRANSLATE, walk);
+    if (!tlb_hit) {
+        if (pte->v == 0) {
+            // Page fault
+            pageFault = 1;
+            PROF_FAULT(&sim->prof, ref, sim->ref_count);
+            PROF_FAULT(&sim->prof, pid, proc->pid);
+            PROF_FAULT(&sim->prof, vpn, vpn);
+            PROF_FAULT(&sim->prof, type, ref->type);
+            sim->pfault_count++;
+            proc->faults++;
+            if (sim->stats_out != NULL) {
+                stats_fault(&sim->stats, ((uint64_t)proc->pid << 48) | vpn, sim->ref_count);
+            }
+            struct timespec fault_start, fault_end;
+            clock_gettime(CLOCK_MONOTONIC, &fault_start);
+            handle_fault(sim, asid, vpn);
+            clock_gettime(CLOCK_MONOTONIC, &fault_end);
+            record_fault_latency(sim, &fault_start, &fault_end);
+
+            // Read ahead if the fault continues a sequential or strided stream
+            if (cfg->ra_window > 0) {
+                sim->ra_pending = ra_on_fault(&sim->ra, asid, vpn, &sim->ra_req) > 0;
+            }
+        }
+        pfn = pte->frame;
+        if (cfg->tlb_size > 0) {
+            tlb_insert(&sim->tlb, asid, vpn, pfn);
+        }
+    }
+
+    uint8_t *data = frame_data(&sim->pm, pfn);
+    if (!pageFault) {
+        // Page hit
+        FrameInfo *fi = &ft->entries[pfn];
+        frame_set_r(ft, pfn);
+        if (sim->next_use != NULL) {
+            fi->next_use = sim->next_use[sim->ref_count];
+        }
+        PROF_START(hit);
+        proc->policy->ops->on_hit(proc->policy, pfn);
+        PROF_STOP(&sim->prof, PROF_POLICY, hit);
+        LOG_TRACE("page hit in frame %d, data: %d", pfn, data[offset]);
+
+        // First use of a prefetched page, the stream may want its next window
+        if (fi->ra != 0) {
+            int stream = fi->ra - 1;
+            fi->ra = 0;
+            sim->ra_pending = ra_on_use(&sim->ra, stream, vpn, &sim->ra_req) > 0;
+        }
+    }
+
+    uint64_t pa = (uint64_t)pfn * cfg->map_size + offset;  // physical address
+
+    // Write the data to the physical address if the memory reference is a write operation
+    if (ref->type == 'w') {
+        LOG_TRACE("writing %d to frame %d offset %d (was %d)", ref->value, pfn, offset, data[offset]);
+        data[offset] = ref->value;
+        // Update the M bit
+        frame_set_m(ft, pfn);
+    }
+
+    // Write the translation and the page fault flag to the output file, in base pages
+    if (out != NULL) {
+        PROF_START(output);
+        writer_ref(out, ref->addr, pte1, pte2, offset & (cfg->page_size - 1), (int)(pa >> cfg->page_shift), pa,
+                   pageFault);
+        PROF_STOP(&sim->prof, PROF_OUTPUT, output);
+    }
+
+    // Prefetch after the access, so that the prefetch cannot evict the page being accessed
+    if (sim->ra_pending) {
+        prefetch(sim, &sim->ra_req);
+        sim->ra_pending = 0;
+    }
+
+    sim->ref_count++;
+    PROF_REF(&sim->prof, pageFault, ref_start);
+    return pageFault;
+}
+
+// Stop the writeback thread, write the modified pages in physical memory to the backing store and the final
+// statistics snapshot
+void sim_finish(Sim *sim) {
+    // Let the writeback thread finish before the last pages are written
+    if (sim->wb != NULL) {
+        wb_stop(sim->wb);
+    }
+    FrameTable *ft = &sim->ft;
+    for (int w = 0; w < ft->words; w++) {
+        for (uint64_t dirty = ft->m[w] & ft->v[w]; dirty != 0; dirty &= dirty - 1) {
+            int i = (w << 6) + __builtin_ctzll(dirty);
+            bs_page_out(&sim->bs, frame_slot(sim, &ft->entries[i]), frame_data(&sim->pm, i));
+        }
+    }
+    if (sim->stats_out != NULL) {
+        stats_write(&sim->stats, sim->stats_out, sim->ref_count, &sim->procs, 1);
+    }
+}
+
+// Print the fault latency summary
+static void report_fault_latency(Sim *sim) {
+    long pfault_count = sim->pfault_count;
+    if (pfault_count == 0) {
+        return;
+    }
+    // Upper bounds of the buckets holding the 50th and 99th percentile
+    long p50 = 0, p99 = 0, seen = 0;
+    for (int i = 0; i < 64; i++) {
+        seen += sim->fault_latency[i];
+        if (p50 == 0 && seen * 100 >= pfault_count * 50) {
+            p50 = 2L << i;
+        }
+        if (p99 == 0 && seen * 100 >= pfault_count * 99) {
+            p99 = 2L << i;
+        }
+    }
+    LOG_INFO("fault latency (%s): mean %.0f ns, p50 < %ld ns, p99 < %ld ns, max %ld ns",
+             sim->wb != NULL ? "writeback thread" : "synchronous writeback",
+             sim->fault_latency_total / pfault_count, p50, p99, sim->fault_latency_max);
+}
+
+// Print the references, faults and resident set of each process
+static void report_processes(Sim *sim) {
+    for (int i = 0; i < sim->procs.count; i++) {
+        Process *p = &sim->procs.list[i];
+        LOG_INFO("process %d: %ld references, %ld page faults (%.2f%%), rss %ld pages, peak rss %ld pages", p->pid,
+                 p->refs, p->faults, p->refs > 0 ? 100.0 * p->faults / p->refs : 0.0, p->rss, p->peak_rss);
+    }
+}
+
+// Print the memory used by the page tables
+static void report_pt_overhead(Sim *sim) {
+    ProcTable *procs = &sim->procs;
+    if (procs->count == 0) {
+        return;
+    }
+    // Totals over the page tables of all processes
+    char per_level[64];
+    int len = 0;
+    long tables = 0;
+    size_t bytes = 0;
+    for (int l = 0; l < procs->list[0].pt.levels; l++) {
+        long n = 0;
+        for (int i = 0; i < procs->count; i++) {
+            n += procs->list[i].pt.tables[l];
+        }
+        len += snprintf(per_level + len, sizeof(per_level) - len, "%s%ld", l > 0 ? "/" : "", n);
+        tables += n;
+    }
+    for (int i = 0; i < procs->count; i++) {
+        bytes += procs->list[i].pt.bytes;
+    }
+    // a single table covering each address space
+    double flat = (double)sim->cfg.page_count * sizeof(PTE) * procs->count;
+    LOG_INFO("page tables: %ld tables (%s per level) for %d processes, %zu bytes, %.3g%% of flat tables", tables,
+             per_level, procs->count, bytes, 100.0 * bytes / flat);
+}
+
+// Print the fault latency, process, TLB, readahead, page table and swap statistics, and the profile if built in
+void sim_report(Sim *sim) {
+    long ref_count = sim->ref_count;
+    long pfault_count = sim->pfault_count;
+    if (sim->wb != NULL) {
+        Writeback *wb = sim->wb;
+        LOG_INFO("writeback: %ld evicted, %ld cleaned, %ld stalls on a full queue, %ld page-ins from the queue",
+                 wb->queued, wb->cleaned, wb->stalls, wb->forwarded);
+    }
+    report_fault_latency(sim);
+    report_processes(sim);
+    report_pt_overhead(sim);
+    if (sim->cfg.tlb_size > 0) {
+        Tlb *tlb = &sim->tlb;
+        LOG_INFO("tlb: %ld hits, %ld misses, hit rate %.1f%%, %ld invalidations, %ld page faults", tlb->hits,
+                 tlb->misses, 100.0 * tlb->hits / (ref_count > 0 ? ref_count : 1), tlb->invalidations, pfault_count);
+    }
+    if (sim->cfg.ra_window > 0) {
+        Readahead *ra = &sim->ra;
+        long wanted = ra->used + pfault_count;  // pages that were needed and not resident without readahead
+        LOG_INFO("readahead: %ld requests, %ld pages prefetched, %ld used, %ld evicted unused, "
+                 "accuracy %.1f%%, coverage %.1f%%", ra->batches, ra->issued, ra->used, ra->wasted,
+                 ra->issued > 0 ? 100.0 * ra->used / ra->issued : 0.0, wanted > 0 ? 100.0 * ra->used / wanted : 0.0);
+    }
+    BackingStore *bs = &sim->bs;
+    int map_size = sim->cfg.map_size;
+    LOG_INFO("swap page-ins = %ld in %ld reads, page-outs = %ld, %ld KB read, %ld KB written", bs->page_ins,
+             bs->reads, bs->page_outs, bs->page_ins * map_size / 1024, bs->page_outs * map_size / 1024);
+    PROF_REPORT(&sim->prof);
+}
+
+// Free everything the simulator allocated and close the swap file, after sim_finish() if the writeback thread runs
+void sim_free(Sim *sim) {
+    bs_close(&sim->bs);
+    if (sim->stats_out != NULL) {
+        fclose(sim->stats_out);
+        stats_free(&sim->stats);
+    }
+    if (sim->cfg.tlb_size > 0) {
+        tlb_free(&sim->tlb);
+    }
+    for (int i = 0; i < sim->procs.count && sim->cfg.local_repl; i++) {
+        policy_free(sim->procs.list[i].policy);
+    }
+    if (sim->policy != NULL) {
+        policy_free(sim->policy);
+    }
+    procs_free(&sim->procs);
+    free(sim->pm.frames);
+    free(sim->ft.entries);
+    free(sim->ft.r);
+    free(sim->ft.m);
+    free(sim->ft.v);
+}
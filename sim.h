@@ -0,0 +1,103 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+#include "bs.h"
+#include "frame.h"
+#include "memsim.h"
+#include "output.h"
+#include "policy.h"
+#include "proc.h"
+#include "prof.h"
+#include "pt.h"
+#include "ra.h"
+#include "stats.h"
+#include "tlb.h"
+#include "trace.h"
+#include "wb.h"
+
+// Structs
+
+// Parameters of one simulation, the fields after swap_direct are derived by sim_config_check()
+typedef struct {
+    int level; // number of levels in the page table, 1 <= level <= 4
+    int va_bits; // width of the virtual addresses: 16, 32, 39 or 48 bits
+    int level_bits[PT_MAX_LEVELS]; // index bits of each page table level, from the root down
+    int fcount; // number of frames in the physical memory, 4 <= fcount <= MAX_FRAMES
+    int page_size; // size of each base page in bytes, a power of two from 64 bytes to 1 MB
+    int huge; // 1 to map memory with huge pages, each covering the base pages of one last-level table
+    char algo[64]; // name of the page replacement algorithm: FIFO, LRU, CLOCK, ECLOCK
+    int local_repl; // 1 if a process evicts its own pages once it holds its share of the frames, 0 to pick victims
+    // among the pages of all processes
+    int tick; // timer tick period in number of memory references done
+    int ws_window; // working-set window of WSCLOCK in memory references, rounded to ticks, 0 for 8 ticks
+    int io_mode; // how the swap file is accessed: mmap, positional I/O or private memory
+    int wb_depth; // writeback queue depth, 0 writes dirty victims synchronously in the fault path
+    int clean_batch; // dirty, unreferenced pages queued for writeback ahead of eviction on each tick
+    int ra_window; // largest number of pages prefetched at once, 0 disables readahead
+    int tlb_size; // number of TLB entries, 0 disables the TLB
+    int tlb_ways; // TLB associativity
+    int tlb_policy; // TLB replacement within a set
+    int page_shift; // log2 of page_size
+    int map_shift; // log2 of the size of a mapping, the unit of paging and swap I/O: a base page or a huge page
+    int map_size; // size of a mapping in bytes
+    long page_count; // number of virtual pages (of huge pages with huge pages)
+    int swap_direct; // 1 if the backing store holds every virtual page of process 0 at its vpn, 0 if pages are
+    // given slots
+} SimConfig;
+
+// One simulator instance. Instances share nothing, so several can run at once on different threads.
+typedef struct {
+    SimConfig cfg; // parameters
+    ProcTable procs; // processes of the trace, each with its own radix page table
+    FrameTable ft; // owner and replacement state of every frame
+    PM pm; // contents of the frames
+    BackingStore bs; // swap space
+    Writeback writeback; // background writeback queue, used if wb_depth > 0
+    Writeback *wb; // &writeback if the writeback thread runs, NULL otherwise
+    Readahead ra; // sequential and strided stream detection for readahead
+    Tlb tlb; // translation cache in front of the page table
+    Policy *policy; // replacement policy shared by all processes with global replacement, NULL with local replacement
+    Process *proc; // process of the current memory reference
+    int asid; // its index in the process table
+    long next_slot; // next free swap slot when pages are given slots, slots follow the pages held at their vpn
+    int clean_cursor; // frame where the next proactive cleaning pass starts
+    long ref_count; // memory references processed
+    const long *next_use; // next reference to the same page for every reference of the trace, NULL unless the
+    // policy is offline (OPT)
+    long pfault_count; // page faults taken
+    RaRequest ra_req; // readahead requested by the current reference, issued once the reference is done
+    int ra_pending; // 1 if ra_req is waiting to be issued
+    long fault_latency[64]; // fault handling time histogram, bucket i counts faults that took [2^i, 2^(i+1)) ns
+    long fault_latency_max; // slowest fault handling time in ns
+    double fault_latency_total; // total fault handling time in ns
+    Stats stats; // counters and histograms for the JSON statistics, kept only while stats_out is open
+    FILE *stats_out; // JSON statistics file, NULL if none was asked for
+    long stats_every; // references between two statistics snapshots, 0 for the final one only
+    Profile prof; // timing probes, only filled in when built with make PROFILE=1 or PROFILE=faults
+} Sim;
+
+
+// Function prototypes
+
+// Check a configuration and derive the mapping size and swap layout, bits_spec gives the index bits of each level
+// (split evenly if empty)
+void sim_config_check(SimConfig *cfg, const char *bits_spec);
+// Set up a simulator with empty frames and page tables over the given swap file. An offline policy (OPT) needs the
+// next-use index of the trace from trace_next_use() at the mapping size, NULL otherwise.
+void sim_init(Sim *sim, const SimConfig *cfg, const char *swapfile, const long *next_use);
+// Keep detailed statistics and write them to a JSON file at the end of the run, and every `every` references if
+// every > 0. Each snapshot is one line.
+void sim_stats_open(Sim *sim, const char *path, long every);
+// Simulate one memory reference and write its translation to out (if not NULL), returns 1 on a page fault
+int sim_ref(Sim *sim, const Ref *ref, Writer *out);
+// Stop the writeback thread, write the modified pages in physical memory to the backing store and the final
+// statistics snapshot
+void sim_finish(Sim *sim);
+// Print the fault latency, process, TLB, readahead, page table and swap statistics, and the profile if built in
+void sim_report(Sim *sim);
+// Free everything the simulator allocated and close the swap file, after sim_finish() if the writeback thread runs
+void sim_free(Sim *sim);
+
+#endif
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "stats.h"
+
+#define STATS_EMPTY UINT64_MAX // free entry of the page hash table
+
+// A page that faulted and its fault count
+typedef struct {
+    uint64_t key; // process ID above the vpn
+    long faults; // faults of the page
+} PageFaults;
+
+// Log2 bucket of a non-negative value, 0 holds 0 and 1
+static int stats_bucket(long v) {
+    return (v > 1) ? 63 - __builtin_clzl(v) : 0;
+}
+
+// Set up empty statistics that sample the resident set every rss_every references at first
+void stats_init(Stats *st, long rss_every) {
+    memset(st, 0, sizeof(Stats));
+    st->last_fault = -1;
+    st->cap = 1024;
+    st->keys = malloc(st->cap * sizeof(uint64_t));
+    st->page_faults = malloc(st->cap * sizeof(long));
+    st->rss_ref = malloc(STATS_RSS_SAMPLES * sizeof(long));
+    st->rss = malloc(STATS_RSS_SAMPLES * sizeof(long));
+    if (st->keys == NULL || st->page_faults == NULL || st->rss_ref == NULL || st->rss == NULL) {
+        fatal("Cannot allocate the statistics");
+    }
+    memset(st->keys, 0xff, st->cap * sizeof(uint64_t));
+    st->rss_every = (rss_every > 0) ? rss_every : 1;
+}
+
+// Entry of a page in the hash table, the free entry it would take if it is not there
+static long stats_find(const Stats *st, uint64_t key) {
+    long i = (long)((key * 0x9E3779B97F4A7C15ull) >> 20) & (st->cap - 1);
+    while (st->keys[i] != STATS_EMPTY && st->keys[i] != key) {
+        i = (i + 1) & (st->cap - 1);
+    }
+    return i;
+}
+
+// Double the hash table
+static void stats_grow(Stats *st) {
+    uint64_t *keys = st->keys;
+    long *faults = st->page_faults;
+    long cap = st->cap;
+    st->cap *= 2;
+    st->keys = malloc(st->cap * sizeof(uint64_t));
+    st->page_faults = malloc(st->cap * sizeof(long));
+    if (st->keys == NULL || st->page_faults == NULL) {
+        fatal("Out of memory for the page fault counts");
+    }
+    memset(st->keys, 0xff, st->cap * sizeof(uint64_t));
+    for (long i = 0; i < cap; i++) {
+        if (keys[i] != STATS_EMPTY) {
+            long j = stats_find(st, keys[i]);
+            st->keys[j] = keys[i];
+            st->page_faults[j] = faults[i];
+        }
+    }
+    free(keys);
+    free(faults);
+}
+
+// Count a page fault on a page key at reference ref
+void stats_fault(Stats *st, uint64_t key, long ref) {
+    st->faults++;
+    if (st->last_fault >= 0) {
+        st->gap_hist[stats_bucket(ref - st->last_fault)]++;
+    }
+    st->last_fault = ref;
+
+    // A page that never faulted before was never resident
+    long i = stats_find(st, key);
+    if (st->keys[i] == STATS_EMPTY) {
+        st->cold_faults++;
+        st->keys[i] = key;
+        st->page_faults[i] = 0;
+        st->pages++;
+    }
+    st->page_faults[i]++;
+    if (st->pages * 2 > st->cap) {
+        stats_grow(st);
+    }
+}
+
+// Count an eviction, dirty if the page was written back, after the clock hands examined travel frames
+void stats_evict(Stats *st, int dirty, long travel) {
+    st->evictions++;
+    st->dirty_evictions += dirty;
+    st->travel += travel;
+    st->travel_hist[stats_bucket(travel)]++;
+}
+
+// Record the resident set at reference ref, thinning out the samples if they are full
+void stats_sample(Stats *st, long ref, long rss) {
+    if (st->rss_count == STATS_RSS_SAMPLES) {
+        // Keep the samples that fall on multiples of the doubled interval and take them half as often
+        for (int i = 0; i < STATS_RSS_SAMPLES / 2; i++) {
+            st->rss_ref[i] = st->rss_ref[2 * i + 1];
+            st->rss[i] = st->rss[2 * i + 1];
+        }
+        st->rss_count = STATS_RSS_SAMPLES / 2;
+        st->rss_every *= 2;
+    }
+    if (ref % st->rss_every == 0) {
+        st->rss_ref[st->rss_count] = ref;
+        st->rss[st->rss_count] = rss;
+        st->rss_count++;
+    }
+}
+
+// Write a histogram as a JSON array, without its empty tail
+static void write_hist(FILE *out, const long *hist) {
+    int n = STATS_BUCKETS;
+    while (n > 0 && hist[n - 1] == 0) {
+        n--;
+    }
+    fputc('[', out);
+    for (int i = 0; i < n; i++) {
+        fprintf(out, "%s%ld", i > 0 ? "," : "", hist[i]);
+    }
+    fputc(']', out);
+}
+
+// Order of the pages by faults, most first, then by page
+static int cmp_page_faults(const void *a, const void *b) {
+    const PageFaults *pa = a;
+    const PageFaults *pb = b;
+    if (pa->faults != pb->faults) {
+        return (pa->faults < pb->faults) ? 1 : -1;
+    }
+    return (pa->key > pb->key) - (pa->key < pb->key);
+}
+
+// Write the statistics after refs references as one line of JSON, with the pages that faulted if final
+void stats_write(const Stats *st, FILE *out, long refs, const ProcTable *procs, int final) {
+    fprintf(out, "{\"refs\":%ld,\"final\":%s,\"hits\":%ld,\"faults\":%ld,\"cold_faults\":%ld,"
+                 "\"capacity_faults\":%ld,\"evictions\":%ld,\"dirty_evictions\":%ld,\"clean_evictions\":%ld,",
+            refs, final ? "true" : "false", refs - st->faults, st->faults, st->cold_faults,
+            st->faults - st->cold_faults, st->evictions, st->dirty_evictions, st->evictions - st->dirty_evictions);
+    fprintf(out, "\"hand_travel\":{\"total\":%ld,\"mean\":%.3f,\"histogram\":", st->travel,
+            st->evictions > 0 ? (double)st->travel / st->evictions : 0.0);
+    write_hist(out, st->travel_hist);
+    fprintf(out, "},\"inter_fault_distance\":{\"histogram\":");
+    write_hist(out, st->gap_hist);
+    fprintf(out, "},\"rss\":{\"every\":%ld,\"samples\":[", st->rss_every);
+    for (int i = 0; i < st->rss_count; i++) {
+        fprintf(out, "%s[%ld,%ld]", i > 0 ? "," : "", st->rss_ref[i], st->rss[i]);
+    }
+    fprintf(out, "]},\"processes\":[");
+    for (int i = 0; i < procs->count; i++) {
+        const Process *p = &procs->list[i];
+        fprintf(out, "%s{\"pid\":%d,\"refs\":%ld,\"faults\":%ld,\"rss\":%ld,\"peak_rss\":%ld}", i > 0 ? "," : "",
+                p->pid, p->refs, p->faults, p->rss, p->peak_rss);
+    }
+    fputc(']', out);
+
+    // Every page that faulted, most faults first, only once the run is over
+    if (final) {
+        PageFaults *pages = malloc((st->pages > 0 ? st->pages : 1) * sizeof(PageFaults));
+        if (pages == NULL) {
+            fatal("Out of memory for the page fault counts");
+        }
+        long n = 0;
+        for (long i = 0; i < st->cap; i++) {
+            if (st->keys[i] != STATS_EMPTY) {
+                pages[n].key = st->keys[i];
+                pages[n].faults = st->page_faults[i];
+                n++;
+            }
+        }
+        qsort(pages, n, sizeof(PageFaults), cmp_page_faults);
+        fprintf(out, ",\"page_faults\":[");
+        for (long i = 0; i < n; i++) {
+            fprintf(out, "%s{\"pid\":%d,\"vpn\":%llu,\"faults\":%ld}", i > 0 ? "," : "", (int)(pages[i].key >> 48),
+                    (unsigned long long)(pages[i].key & ((1ull << 48) - 1)), pages[i].faults);
+        }
+        fputc(']', out);
+        free(pages);
+    }
+    fprintf(out, "}\n");
+    fflush(out);
+}
+
+// Free the statistics
+void stats_free(Stats *st) {
+    free(st->keys);
+    free(st->page_faults);
+    free(st->rss_ref);
+    free(st->rss);
+}
@@ -0,0 +1,52 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "proc.h"
+
+#define STATS_BUCKETS 64 // buckets of the log2 histograms
+#define STATS_RSS_SAMPLES 1024 // resident-set samples kept, every other one is dropped when they run out
+
+// Structs
+
+// Counters and histograms of one simulation, written as JSON. Hits are the references that did not fault, and a
+// fault is a capacity fault unless the page was never resident before (a cold fault).
+typedef struct {
+    long faults; // page faults
+    long cold_faults; // faults on pages that were never resident
+    long evictions; // pages evicted to make room
+    long dirty_evictions; // evicted pages that were written back
+    long travel; // frames the clock hands examined, summed over all evictions
+    long travel_hist[STATS_BUCKETS]; // travel_hist[i] counts evictions whose hands examined [2^i, 2^(i+1)) frames
+    long gap_hist[STATS_BUCKETS]; // gap_hist[i] counts faults [2^i, 2^(i+1)) references after the previous one
+    long last_fault; // reference of the previous fault, -1 before the first
+    uint64_t *keys; // hash table of the pages that faulted (process ID above the vpn), open addressing,
+    // UINT64_MAX marks a free entry
+    long *page_faults; // faults of the page in the same entry of keys
+    long cap; // entries of the hash table, a power of two
+    long pages; // pages in the hash table
+    long *rss_ref; // reference of each resident-set sample
+    long *rss; // resident pages of all processes at each sample
+    int rss_count; // samples taken
+    long rss_every; // references between samples, doubled whenever the samples are thinned out
+} Stats;
+
+
+// Function prototypes
+
+// Set up empty statistics that sample the resident set every rss_every references at first
+void stats_init(Stats *st, long rss_every);
+// Count a page fault on a page key at reference ref
+void stats_fault(Stats *st, uint64_t key, long ref);
+// Count an eviction, dirty if the page was written back, after the clock hands examined travel frames
+void stats_evict(Stats *st, int dirty, long travel);
+// Record the resident set at reference ref, thinning out the samples if they are full
+void stats_sample(Stats *st, long ref, long rss);
+// Write the statistics after refs references as one line of JSON, with the pages that faulted if final
+void stats_write(const Stats *st, FILE *out, long refs, const ProcTable *procs, int final);
+// Free the statistics
+void stats_free(Stats *st);
+
+#endif
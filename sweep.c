@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "sweep.h"
+
+// Work shared by the threads of a sweep
+typedef struct {
+    SweepRun *runs; // the runs
+    int count; // number of runs
+    const Ref *refs; // memory references, read-only
+    long ref_count; // number of memory references
+    const char *swapfile; // initial contents of the swap space
+    _Atomic int next; // next run to start
+} Sweep;
+
+// Take runs off the sweep until none are left
+static void *sweep_worker(void *arg) {
+    Sweep *sw = arg;
+    for (;;) {
+        int i = atomic_fetch_add(&sw->next, 1);
+        if (i >= sw->count) {
+            return NULL;
+        }
+        SweepRun *run = &sw->runs[i];
+        Sim *sim = malloc(sizeof(Sim));
+        if (sim == NULL) {
+            fatal("Cannot allocate a simulator");
+        }
+        sim_init(sim, &run->cfg, sw->swapfile, run->next_use);
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (long r = 0; r < sw->ref_count; r++) {
+            sim_ref(sim, &sw->refs[r], NULL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        run->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        run->faults = sim->pfault_count;
+        run->page_ins = sim->bs.page_ins;
+        run->page_outs = sim->bs.page_outs;
+        sim_free(sim);
+        free(sim);
+        LOG_INFO("sweep: level %d, %d frames, %s: %ld page faults", run->cfg.level, run->cfg.fcount, run->cfg.algo,
+                 run->faults);
+    }
+}
+
+// Simulate the references of a trace once per run on a pool of threads (0 for one per CPU). The runs share the
+// references read-only, and each keeps its swap space in private memory on top of the swap file.
+void sweep_run(SweepRun *runs, int count, const Ref *refs, long ref_count, const char *swapfile, int threads) {
+    if (threads <= 0) {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads > count) {
+        threads = count;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    Sweep sw;
+    sw.runs = runs;
+    sw.count = count;
+    sw.refs = refs;
+    sw.ref_count = ref_count;
+    sw.swapfile = swapfile;
+    atomic_init(&sw.next, 0);
+
+    pthread_t *pool = malloc(threads * sizeof(pthread_t));
+    if (pool == NULL) {
+        fatal("Cannot allocate %d sweep threads", threads);
+    }
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&pool[t], NULL, sweep_worker, &sw) != 0) {
+            fatal("Cannot start sweep thread %d", t);
+        }
+    }
+    for (int t = 0; t < threads; t++) {
+        pthread_join(pool[t], NULL);
+    }
+    free(pool);
+}
@@ -0,0 +1,26 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "sim.h"
+#include "trace.h"
+
+// Structs
+
+// One run of a parameter sweep
+typedef struct {
+    SimConfig cfg; // configuration of the run
+    const long *next_use; // next-use index of the trace at the run's mapping size if its policy is offline, or NULL
+    long faults; // page faults taken, filled in once the run is done
+    long page_ins; // pages read from the swap space, filled in once the run is done
+    long page_outs; // pages written to the swap space, filled in once the run is done
+    double seconds; // time spent simulating the references, filled in once the run is done
+} SweepRun;
+
+
+// Function prototypes
+
+// Simulate the references of a trace once per run on a pool of threads (0 for one per CPU). The runs share the
+// references read-only, and each keeps its swap space in private memory on top of the swap file.
+void sweep_run(SweepRun *runs, int count, const Ref *refs, long ref_count, const char *swapfile, int threads);
+
+#endif
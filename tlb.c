@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+#include "tlb.h"
+
+// Allocate an empty TLB of the given number of entries and ways
+void tlb_init(Tlb *tlb, int entries, int ways, int repl) {
+    if (ways < 1 || ways > 255 || entries < ways || entries % ways != 0) {
+        fatal("TLB entries must be a multiple of the number of ways");
+    }
+    tlb->sets = entries / ways;
+    if ((tlb->sets & (tlb->sets - 1)) != 0) {
+        fatal("The number of TLB sets (entries / ways) must be a power of two");
+    }
+    tlb->ways = ways;
+    tlb->repl = repl;
+    tlb->entries = malloc((size_t)entries * sizeof(TlbEntry));
+    if (tlb->entries == NULL) {
+        fatal("Cannot allocate %d TLB entries", entries);
+    }
+    for (int i = 0; i < entries; i++) {
+        tlb->entries[i].vpn = -1;
+        tlb->entries[i].asid = 0;
+        tlb->entries[i].frame = 0;
+        tlb->entries[i].stamp = 0;
+    }
+    tlb->fifo_next = calloc(tlb->sets, 1);
+    if (tlb->fifo_next == NULL) {
+        fatal("Cannot allocate the TLB replacement state");
+    }
+    tlb->clock = 0;
+    tlb->seed = 2463534242u;
+    tlb->hits = 0;
+    tlb->misses = 0;
+    tlb->invalidations = 0;
+}
+
+// Set of a virtual page, the address space is mixed in so that processes using the same pages spread over the sets
+static long tlb_set(Tlb *tlb, int asid, long vpn) {
+    return (vpn ^ asid) & (tlb->sets - 1);
+}
+
+// Look up the frame of a virtual page of address space asid, returns 1 on a hit
+int tlb_lookup(Tlb *tlb, int asid, long vpn, int *frame) {
+    TlbEntry *set = &tlb->entries[tlb_set(tlb, asid, vpn) * tlb->ways];
+    for (int w = 0; w < tlb->ways; w++) {
+        if (set[w].vpn == vpn && set[w].asid == asid) {
+            set[w].stamp = ++tlb->clock;
+            *frame = set[w].frame;
+            tlb->hits++;
+            return 1;
+        }
+    }
+    tlb->misses++;
+    return 0;
+}
+
+// Cache the translation of a virtual page after a page table walk
+void tlb_insert(Tlb *tlb, int asid, long vpn, int frame) {
+    long index = tlb_set(tlb, asid, vpn);
+    TlbEntry *set = &tlb->entries[index * tlb->ways];
+
+    // Fill an empty way first
+    int way = -1;
+    for (int w = 0; w < tlb->ways && way < 0; w++) {
+        if (set[w].vpn == -1) {
+            way = w;
+        }
+    }
+    if (way < 0) {
+        if (tlb->repl == TLB_LRU) {
+            way = 0;
+            for (int w = 1; w < tlb->ways; w++) {
+                if (set[w].stamp < set[way].stamp) {
+                    way = w;
+                }
+            }
+        } else if (tlb->repl == TLB_FIFO) {
+            way = tlb->fifo_next[index];
+            tlb->fifo_next[index] = (way + 1) % tlb->ways;
+        } else {
+            // xorshift32
+            tlb->seed ^= tlb->seed << 13;
+            tlb->seed ^= tlb->seed >> 17;
+            tlb->seed ^= tlb->seed << 5;
+            way = tlb->seed % tlb->ways;
+        }
+    }
+
+    set[way].vpn = vpn;
+    set[way].asid = asid;
+    set[way].frame = frame;
+    set[way].stamp = ++tlb->clock;
+}
+
+// Drop the translation of a virtual page that is no longer resident
+void tlb_invalidate(Tlb *tlb, int asid, long vpn) {
+    TlbEntry *set = &tlb->entries[tlb_set(tlb, asid, vpn) * tlb->ways];
+    for (int w = 0; w < tlb->ways; w++) {
+        if (set[w].vpn == vpn && set[w].asid == asid) {
+            set[w].vpn = -1;
+            tlb->invalidations++;
+            return;
+        }
+    }
+}
+
+// Free the TLB
+void tlb_free(Tlb *tlb) {
+    free(tlb->entries);
+    free(tlb->fifo_next);
+}
+
+// Parse the name of a TLB replacement policy, returns -1 if unknown
+int tlb_repl(const char *name) {
+    if (strcmp(name, "lru") == 0) {
+        return TLB_LRU;
+    } else if (strcmp(name, "fifo") == 0) {
+        return TLB_FIFO;
+    } else if (strcmp(name, "random") == 0) {
+        return TLB_RANDOM;
+    }
+    return -1;
+}
@@ -0,0 +1,51 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdint.h>
+
+// TLB replacement within a set, selected with the third field of -T
+#define TLB_LRU 0 // least recently used entry (default)
+#define TLB_FIFO 1 // oldest entry
+#define TLB_RANDOM 2 // random entry
+
+// Structs
+
+// Cached translation
+typedef struct {
+    long vpn; // virtual page number, -1 if the entry is empty
+    int asid; // address space the page belongs to
+    int frame; // frame the page is mapped to
+    unsigned long stamp; // last use, for LRU
+} TlbEntry;
+
+// Set-associative TLB in front of the page table walk
+typedef struct {
+    TlbEntry *entries; // sets * ways entries, the ways of a set are contiguous
+    int sets; // number of sets, a power of two
+    int ways; // entries per set
+    int repl; // TLB_LRU, TLB_FIFO or TLB_RANDOM
+    unsigned char *fifo_next; // next way to replace in each set for TLB_FIFO
+    unsigned long clock; // counts lookups, source of the LRU stamps
+    uint32_t seed; // random number state for TLB_RANDOM
+    long hits; // lookups that found the translation
+    long misses; // lookups that had to walk the page table
+    long invalidations; // entries dropped because their page was evicted
+} Tlb;
+
+
+// Function prototypes
+
+// Allocate an empty TLB of the given number of entries and ways
+void tlb_init(Tlb *tlb, int entries, int ways, int repl);
+// Look up the frame of a virtual page of address space asid, returns 1 on a hit
+int tlb_lookup(Tlb *tlb, int asid, long vpn, int *frame);
+// Cache the translation of a virtual page after a page table walk
+void tlb_insert(Tlb *tlb, int asid, long vpn, int frame);
+// Drop the translation of a virtual page that is no longer resident
+void tlb_invalidate(Tlb *tlb, int asid, long vpn);
+// Free the TLB
+void tlb_free(Tlb *tlb);
+// Parse the name of a TLB replacement policy, returns -1 if unknown
+int tlb_repl(const char *name);
+
+#endif
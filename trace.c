@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "log.h"
+#include "trace.h"
+
+// Value of each hex digit plus one, 0 for characters that are not hex digits
+static const uint8_t hex_digit[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+    ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+// Parse a hex number (with an optional 0x prefix) after any blanks, returns the number of digits read
+static int parse_hex(const char **cursor, const char *end, uint64_t *value) {
+    const char *p = *cursor;
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        p++;
+    }
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && hex_digit[(uint8_t)p[2]]) {
+        p += 2;
+    }
+    const char *start = p;
+    uint64_t v = 0;
+    while (p < end && hex_digit[(uint8_t)*p]) {
+        v = (v << 4) | (uint64_t)(hex_digit[(uint8_t)*p] - 1);
+        p++;
+    }
+    *cursor = p;
+    *value = v;
+    return (int)(p - start);
+}
+
+// Read a little-endian field of the given width
+static uint64_t read_le(const uint8_t *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+// Write a little-endian field of the given width
+static void write_le(uint8_t *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+// Decode a varint, returns 0 if the record is cut off by the end of the file
+static int read_varint(const uint8_t **cursor, const uint8_t *end, uint64_t *value) {
+    const uint8_t *p = *cursor;
+    uint64_t v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            *cursor = p;
+            *value = v;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Encode a varint, returns the number of bytes written
+static int write_varint(uint8_t *p, uint64_t v) {
+    int n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+// Map the address file and prepare it for streaming
+void trace_open(Trace *trace, const char *addrfile) {
+    int fd = open(addrfile, O_RDONLY);
+    if (fd < 0) {
+        fatal("Address file does not exist");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        fatal("Cannot stat the address file");
+    }
+
+    trace->size = st.st_size;
+    trace->pos = 0;
+    trace->released = 0;
+    trace->line = 1;
+    trace->data = NULL;
+    trace->binary = 0;
+    trace->addr_bits = 16;
+    trace->page_size = 0;
+    trace->remaining = 0;
+    trace->prev_addr = 0;
+    trace->prev_pid = 0;
+    trace->version = 0;
+
+    if (trace->size > 0) {
+        void *data = mmap(NULL, trace->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            fatal("Cannot map the address file");
+        }
+        madvise(data, trace->size, MADV_SEQUENTIAL);
+        trace->data = data;
+    }
+
+    close(fd);  // The mapping keeps the file contents available
+
+    // Binary traces start with the magic string, text traces with r or w
+    if (trace->size >= MTRACE_HEADER_SIZE && memcmp(trace->data, MTRACE_MAGIC, 4) == 0) {
+        const uint8_t *header = (const uint8_t *)trace->data;
+        trace->version = (int)read_le(header + 4, 2);
+        if (trace->version < 1 || trace->version > MTRACE_VERSION) {
+            fatal("Unsupported binary trace version");
+        }
+        trace->binary = 1;
+        trace->addr_bits = header[6];
+        trace->page_size = (int)read_le(header + 8, 4);
+        trace->remaining = read_le(header + 12, 8);
+        trace->pos = MTRACE_HEADER_SIZE;
+    }
+}
+
+// Decode up to max memory references from a binary trace
+static int trace_next_binary(Trace *trace, Ref *refs, int max) {
+    const uint8_t *p = (const uint8_t *)trace->data + trace->pos;
+    const uint8_t *end = (const uint8_t *)trace->data + trace->size;
+    int n = 0;
+    uint64_t addr = trace->prev_addr;
+    int pid = trace->prev_pid;
+    int flag_bits = (trace->version >= 2) ? 2 : 1;  // version 1 records have no pid_changed bit
+
+    while (n < max && trace->remaining > 0) {
+        uint64_t word;
+        uint64_t value = 0;
+        if (!read_varint(&p, end, &word)) {
+            fatal("Binary trace is truncated");
+        }
+        uint64_t zigzag = word >> flag_bits;
+        addr += (zigzag >> 1) ^ -(zigzag & 1);  // Undo the zigzag encoding of the delta
+        if (flag_bits == 2 && (word & 2)) {
+            if (!read_varint(&p, end, &value)) {
+                fatal("Binary trace is truncated");
+            }
+            pid = (int)value;
+            value = 0;
+        }
+        if ((word & 1) && !read_varint(&p, end, &value)) {
+            fatal("Binary trace is truncated");
+        }
+        refs[n].pid = pid;
+        refs[n].type = (word & 1) ? 'w' : 'r';
+        refs[n].addr = addr;
+        refs[n].value = (int)value;
+        n++;
+        trace->remaining--;
+    }
+
+    trace->prev_addr = addr;
+    trace->prev_pid = pid;
+    trace->pos = (const char *)p - trace->data;
+    return n;
+}
+
+// Decode up to max memory references from a text trace
+static int trace_next_text(Trace *trace, Ref *refs, int max) {
+    const char *p = trace->data + trace->pos;
+    const char *end = trace->data + trace->size;
+    int n = 0;
+
+    while (n < max && p < end) {
+        char type = *p;
+        if (type == '\n' || type == '\r') {
+            // Skip empty lines
+            if (type == '\n') {
+                trace->line++;
+            }
+            p++;
+            continue;
+        }
+
+        // An optional decimal process ID comes first
+        int pid = 0;
+        if (type >= '0' && type <= '9') {
+            while (p < end && *p >= '0' && *p <= '9') {
+                if (pid > (INT_MAX - 9) / 10) {
+                    fatal("Process ID too large at line %ld", trace->line);
+                }
+                pid = pid * 10 + (*p++ - '0');
+            }
+            while (p < end && (*p == ' ' || *p == '\t')) {
+                p++;
+            }
+            type = (p < end) ? *p : '\n';
+        }
+        if (type != 'r' && type != 'w') {
+            fatal("Wrong memory reference type at line %ld", trace->line);
+        }
+        p++;
+
+        Ref *ref = &refs[n];
+        uint64_t value = 0;
+        ref->pid = pid;
+        ref->type = type;
+        if (parse_hex(&p, end, &ref->addr) == 0) {
+            fatal("Missing address at line %ld", trace->line);
+        }
+        if (type == 'w' && parse_hex(&p, end, &value) == 0) {
+            fatal("Missing value at line %ld", trace->line);
+        }
+        ref->value = (int)value;
+        n++;
+
+        // Move to the start of the next line
+        const char *eol = memchr(p, '\n', end - p);
+        p = (eol != NULL) ? eol + 1 : end;
+        trace->line++;
+    }
+
+    trace->pos = p - trace->data;
+    return n;
+}
+
+// Decode up to max memory references into refs, returns the number decoded (0 at end of file)
+int trace_next(Trace *trace, Ref *refs, int max) {
+    int n = trace->binary ? trace_next_binary(trace, refs, max) : trace_next_text(trace, refs, max);
+
+    // Drop the pages that were already parsed so memory use stays bounded
+    while (trace->pos - trace->released > TRACE_WINDOW) {
+        madvise((void *)(trace->data + trace->released), TRACE_WINDOW, MADV_DONTNEED);
+        trace->released += TRACE_WINDOW;
+    }
+
+    return n;
+}
+
+// Decode every remaining memory reference into one array, returns the number decoded
+long trace_load(Trace *trace, Ref **refs) {
+    // Binary traces know their length (one spare entry sees the end), text traces grow the array as they go
+    size_t cap = trace->binary ? trace->remaining + 1 : TRACE_CHUNK;
+    Ref *all = malloc(cap * sizeof(Ref));
+    size_t count = 0;
+    int n;
+    do {
+        if (count == cap) {
+            cap *= 2;
+            all = realloc(all, cap * sizeof(Ref));
+        }
+        if (all == NULL) {
+            fatal("Out of memory for the trace");
+        }
+        n = trace_next(trace, all + count, (cap - count < TRACE_CHUNK) ? (int)(cap - count) : TRACE_CHUNK);
+        count += n;
+    } while (n > 0);
+    *refs = all;
+    return (long)count;
+}
+
+// Index of the next reference to the same page of the same process for each of count references, LONG_MAX if there
+// is none. Pages are 1 << page_shift bytes.
+long *trace_next_use(const Ref *refs, long count, int page_shift) {
+    long *next = malloc((count > 0 ? count : 1) * sizeof(long));
+    // Open addressing table from page to its earliest reference seen so far, at most half full. Page numbers have at
+    // most 42 bits, the process ID goes above them, so no key has every bit set.
+    size_t cap = 1024;
+    while (cap < 2 * (size_t)count) {
+        cap *= 2;
+    }
+    uint64_t *keys = malloc(cap * sizeof(uint64_t));
+    long *first = malloc(cap * sizeof(long));
+    if (next == NULL || keys == NULL || first == NULL) {
+        fatal("Out of memory for the next-use index");
+    }
+    memset(keys, 0xff, cap * sizeof(uint64_t));
+
+    // Walk backwards, each reference is followed by the one the page last had
+    for (long i = count - 1; i >= 0; i--) {
+        uint64_t key = ((uint64_t)refs[i].pid << 48) | (refs[i].addr >> page_shift);
+        size_t h = (size_t)((key * 0x9E3779B97F4A7C15ull) >> 20) & (cap - 1);
+        while (keys[h] != UINT64_MAX && keys[h] != key) {
+            h = (h + 1) & (cap - 1);
+        }
+        next[i] = (keys[h] == key) ? first[h] : LONG_MAX;
+        keys[h] = key;
+        first[h] = i;
+    }
+    free(keys);
+    free(first);
+    return next;
+}
+
+// Unmap the address file
+void trace_close(Trace *trace) {
+    if (trace->data != NULL) {
+        munmap((void *)trace->data, trace->size);
+    }
+    trace->data = NULL;
+}
+
+// Encode a binary trace header into buf (MTRACE_HEADER_SIZE bytes)
+void mtrace_encode_header(uint8_t *buf, const MTraceHeader *header) {
+    memcpy(buf, MTRACE_MAGIC, 4);
+    write_le(buf + 4, MTRACE_VERSION, 2);
+    buf[6] = (uint8_t)header->addr_bits;
+    buf[7] = 0;  // flags, reserved
+    write_le(buf + 8, header->page_size, 4);
+    write_le(buf + 12, header->ref_count, 8);
+}
+
+// Encode one memory reference into buf (at most MTRACE_MAX_RECORD bytes) after the reference in prev, which is
+// updated, returns the number of bytes written
+int mtrace_encode_ref(uint8_t *buf, const Ref *ref, Ref *prev) {
+    int64_t delta = (int64_t)(ref->addr - prev->addr);
+    uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    int is_write = (ref->type == 'w');
+    int pid_changed = (ref->pid != prev->pid);
+    int n = write_varint(buf, (zigzag << 2) | (pid_changed << 1) | is_write);
+    if (pid_changed) {
+        n += write_varint(buf + n, (uint32_t)ref->pid);
+    }
+    if (is_write) {
+        n += write_varint(buf + n, (uint32_t)ref->value);
+    }
+    *prev = *ref;
+    return n;
+}
+
+// Narrowest virtual address width the simulator supports (16, 32, 39 or 48 bits) that holds addr_bits bit addresses,
+// 0 if none does
+int trace_va_bits(int addr_bits) {
+    static const int widths[] = {16, 32, 39, 48};
+    for (int i = 0; i < 4; i++) {
+        if (addr_bits <= widths[i]) {
+            return widths[i];
+        }
+    }
+    return 0;
+}
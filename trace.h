@@ -0,0 +1,79 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of memory references decoded per call to trace_next()
+#define TRACE_CHUNK 4096
+
+// Bytes of the mapped address file kept resident behind the parse position
+#define TRACE_WINDOW (16 << 20)
+
+// Binary trace (.mtrace) layout, all fields little-endian:
+//   header:  "MTRC" | version u16 | address width u8 | flags u8 | page size u32 | ref count u64
+//   records: varint(zigzag(addr - previous addr) << 2 | pid_changed << 1 | is_write)
+//            [varint(pid) if pid_changed] [varint(value) if is_write]
+// Version 1 records have no pid_changed bit and belong to process 0.
+#define MTRACE_MAGIC "MTRC"
+#define MTRACE_VERSION 2
+#define MTRACE_HEADER_SIZE 20
+#define MTRACE_MAX_RECORD 20 // longest encoded record: 10 byte address varint + 5 byte pid and value varints
+
+// Structs
+
+// Memory reference
+typedef struct {
+    int pid; // process that made the reference, 0 if the trace has no process IDs
+    char type; // type of memory reference: r (read), w (write)
+    uint64_t addr; // virtual address
+    int value; // value to write (if type is w)
+} Ref;
+
+// Streaming reader over a memory-mapped address file
+typedef struct {
+    const char *data; // mapping of the address file
+    size_t size; // size of the address file in bytes
+    size_t pos; // parse position
+    size_t released; // bytes before this offset have been dropped from memory
+    long line; // current line number, for error messages
+    int binary; // 1 if the address file is a .mtrace binary trace
+    int version; // version of a binary trace
+    int addr_bits; // width of the virtual addresses recorded in the trace header
+    int page_size; // page size recorded in the trace header, 0 if unknown
+    uint64_t remaining; // number of records left in a binary trace
+    uint64_t prev_addr; // previous address, base of the delta encoding
+    int prev_pid; // process of the previous record of a binary trace
+} Trace;
+
+// Header of a binary trace
+typedef struct {
+    int addr_bits; // width of the virtual addresses
+    int page_size; // page size the trace was recorded with
+    uint64_t ref_count; // number of records that follow the header
+} MTraceHeader;
+
+
+// Function prototypes
+
+// Map the address file and prepare it for streaming
+void trace_open(Trace *trace, const char *addrfile);
+// Decode up to max memory references into refs, returns the number decoded (0 at end of file)
+int trace_next(Trace *trace, Ref *refs, int max);
+// Decode every remaining memory reference into one array, returns the number decoded
+long trace_load(Trace *trace, Ref **refs);
+// Index of the next reference to the same page of the same process for each of count references, LONG_MAX if there
+// is none. Pages are 1 << page_shift bytes.
+long *trace_next_use(const Ref *refs, long count, int page_shift);
+// Unmap the address file
+void trace_close(Trace *trace);
+// Encode a binary trace header into buf (MTRACE_HEADER_SIZE bytes)
+void mtrace_encode_header(uint8_t *buf, const MTraceHeader *header);
+// Encode one memory reference into buf (at most MTRACE_MAX_RECORD bytes) after the reference in prev, which is
+// updated, returns the number of bytes written
+int mtrace_encode_ref(uint8_t *buf, const Ref *ref, Ref *prev);
+// Narrowest virtual address width the simulator supports (16, 32, 39 or 48 bits) that holds addr_bits bit addresses,
+// 0 if none does
+int trace_va_bits(int addr_bits);
+
+#endif
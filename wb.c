@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+#include "log.h"
+#include "wb.h"
+
+// Worker thread: write the queued pages to the backing store in order
+static void *wb_worker(void *arg) {
+    Writeback *wb = arg;
+    struct timespec idle = {0, 20000};  // 20 us between polls of an empty queue
+    unsigned long tail = atomic_load_explicit(&wb->tail, memory_order_relaxed);
+    for (;;) {
+        unsigned long head = atomic_load_explicit(&wb->head, memory_order_acquire);
+        if (tail == head) {
+            if (atomic_load_explicit(&wb->stop, memory_order_acquire)) {
+                // Nothing can be queued after stop is set, check once more and exit
+                if (tail == atomic_load_explicit(&wb->head, memory_order_acquire)) {
+                    break;
+                }
+                continue;
+            }
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        while (tail != head) {
+            WbSlot *entry = &wb->slots[tail & (wb->depth - 1)];
+            bs_page_out(wb->bs, entry->slot, entry->data);
+            tail++;
+            // Publish the entry as free only after the page is in the backing store
+            atomic_store_explicit(&wb->tail, tail, memory_order_release);
+        }
+    }
+    return NULL;
+}
+
+// Allocate the queue and start the worker thread
+void wb_start(Writeback *wb, BackingStore *bs, int depth) {
+    int size = 1;
+    while (size < depth) {
+        size <<= 1;
+    }
+    wb->bs = bs;
+    wb->depth = size;
+    wb->slots = malloc(size * sizeof(WbSlot));
+    wb->buffers = malloc((size_t)size * bs->page_size);
+    if (wb->slots == NULL || wb->buffers == NULL) {
+        fatal("Cannot allocate the writeback queue");
+    }
+    for (int i = 0; i < size; i++) {
+        wb->slots[i].slot = -1;
+        wb->slots[i].data = wb->buffers + (size_t)i * bs->page_size;
+    }
+    atomic_init(&wb->head, 0);
+    atomic_init(&wb->tail, 0);
+    atomic_init(&wb->stop, 0);
+    wb->queued = 0;
+    wb->cleaned = 0;
+    wb->stalls = 0;
+    wb->forwarded = 0;
+    if (pthread_create(&wb->thread, NULL, wb_worker, wb) != 0) {
+        fatal("Cannot start the writeback thread");
+    }
+}
+
+// Fill the queue entry at head and publish it to the worker
+static void wb_push(Writeback *wb, unsigned long head, long slot, const void *page) {
+    WbSlot *entry = &wb->slots[head & (wb->depth - 1)];
+    entry->slot = slot;
+    memcpy(entry->data, page, wb->bs->page_size);
+    atomic_store_explicit(&wb->head, head + 1, memory_order_release);
+}
+
+// Queue a copy of a dirty page, waiting for a free slot if the queue is full
+void wb_enqueue(Writeback *wb, long slot, const void *page) {
+    unsigned long head = atomic_load_explicit(&wb->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&wb->tail, memory_order_acquire) == (unsigned long)wb->depth) {
+        wb->stalls++;
+        while (head - atomic_load_explicit(&wb->tail, memory_order_acquire) == (unsigned long)wb->depth) {
+            sched_yield();
+        }
+    }
+    wb_push(wb, head, slot, page);
+    wb->queued++;
+}
+
+// Queue a copy of a dirty page only if a slot is free, returns 1 if it was queued
+int wb_try_enqueue(Writeback *wb, long slot, const void *page) {
+    unsigned long head = atomic_load_explicit(&wb->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&wb->tail, memory_order_acquire) == (unsigned long)wb->depth) {
+        return 0;
+    }
+    wb_push(wb, head, slot, page);
+    wb->cleaned++;
+    return 1;
+}
+
+// Copy the newest queued version of the page in a swap slot into frame, returns 0 if the page is not queued
+int wb_lookup(Writeback *wb, long slot, void *frame) {
+    // Slots between tail and head are only rewritten by this thread, so reading them is safe
+    // even while the worker is writing them out
+    unsigned long head = atomic_load_explicit(&wb->head, memory_order_relaxed);
+    unsigned long tail = atomic_load_explicit(&wb->tail, memory_order_acquire);
+    while (head != tail) {
+        head--;
+        WbSlot *entry = &wb->slots[head & (wb->depth - 1)];
+        if (entry->slot == slot) {
+            memcpy(frame, entry->data, wb->bs->page_size);
+            wb->forwarded++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Number of free slots in the queue
+int wb_free_slots(Writeback *wb) {
+    unsigned long head = atomic_load_explicit(&wb->head, memory_order_relaxed);
+    return wb->depth - (int)(head - atomic_load_explicit(&wb->tail, memory_order_acquire));
+}
+
+// Drain the queue and stop the worker thread
+void wb_stop(Writeback *wb) {
+    atomic_store_explicit(&wb->stop, 1, memory_order_release);
+    pthread_join(wb->thread, NULL);
+    free(wb->slots);
+    free(wb->buffers);
+}
@@ -0,0 +1,52 @@
+#ifndef WB_H
+#define WB_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "bs.h"
+
+// Structs
+
+// Dirty page waiting to be written back
+typedef struct {
+    long slot; // swap slot the page is written to
+    uint8_t *data; // copy of the page contents
+} WbSlot;
+
+// Background writeback: the fault path queues copies of dirty pages and a worker
+// thread writes them to the backing store. The queue is a bounded single-producer,
+// single-consumer ring, so neither side takes a lock.
+typedef struct {
+    BackingStore *bs; // where the pages are written
+    int depth; // queue capacity, a power of two
+    WbSlot *slots; // ring of queued pages
+    uint8_t *buffers; // page copies, one per slot
+    _Atomic unsigned long head; // next slot the simulator fills
+    _Atomic unsigned long tail; // next slot the worker drains
+    _Atomic int stop; // set to make the worker exit once the queue is empty
+    pthread_t thread; // the worker
+    long queued; // pages queued by evictions
+    long cleaned; // pages queued by proactive cleaning
+    long stalls; // times the simulator waited for a free slot
+    long forwarded; // page-ins served from a queued copy
+} Writeback;
+
+
+// Function prototypes
+
+// Allocate the queue and start the worker thread
+void wb_start(Writeback *wb, BackingStore *bs, int depth);
+// Queue a copy of a dirty page, waiting for a free slot if the queue is full
+void wb_enqueue(Writeback *wb, long slot, const void *page);
+// Queue a copy of a dirty page only if a slot is free, returns 1 if it was queued
+int wb_try_enqueue(Writeback *wb, long slot, const void *page);
+// Copy the newest queued version of the page in a swap slot into frame, returns 0 if the page is not queued
+int wb_lookup(Writeback *wb, long slot, void *frame);
+// Number of free slots in the queue
+int wb_free_slots(Writeback *wb);
+// Drain the queue and stop the worker thread
+void wb_stop(Writeback *wb);
+
+#endif